@@ -0,0 +1,145 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/texture_atlas_pack.h"
+
+#define ENABLE_LOGS
+#include "../src/debug.h"
+
+/**
+ * CPU check of atlas packing, no GL context needed
+ * usage: atlas_check
+ *
+ * packed sprites have to stay inside their page without their padded areas overlapping,
+ * full pages fail or spill into the next layer, blitted padding repeats the sprite edge
+ * and nothing outside the padded area is written
+ * exits with failure on the first mismatch
+ */
+
+#define ATLAS_CHECK_PAGE 64
+#define ATLAS_CHECK_PADDING 2
+
+static int failures;
+
+static void atlas_fail(const char* what, int value)
+{
+    my_log(ERRMSG("%s: %d\n"), what, value);
+    failures++;
+}
+
+static bool atlas_overlap(const texture_atlas_rect* a, const texture_atlas_rect* b, int padding)
+{
+    return a->layer == b->layer
+        && a->x < b->x + b->width + 2 * padding && b->x < a->x + a->width + 2 * padding
+        && a->y < b->y + b->height + 2 * padding && b->y < a->y + a->height + 2 * padding;
+}
+
+static void atlas_check_placement(texture_atlas_rect* rects, int count, int layers, int padding)
+{
+    for (int i = 0; i < count; i++)
+    {
+        const texture_atlas_rect* rect = &rects[i];
+        if (rect->x < 0 || rect->y < 0 || rect->x + rect->width + 2 * padding > ATLAS_CHECK_PAGE
+            || rect->y + rect->height + 2 * padding > ATLAS_CHECK_PAGE || rect->layer < 0 || rect->layer >= layers)
+            atlas_fail("rect outside its page", i);
+
+        for (int j = i + 1; j < count; j++)
+            if (atlas_overlap(rect, &rects[j], padding))
+                atlas_fail("padded rects overlap", i * 100 + j);
+    }
+}
+
+static void atlas_check_pack(void)
+{
+    // mixed sizes, fits one page
+    texture_atlas_rect rects[] = {
+        { .width = 20, .height = 12 }, { .width = 7, .height = 30 }, { .width = 16, .height = 16 },
+        { .width = 1, .height = 1 }, { .width = 30, .height = 5 }, { .width = 11, .height = 12 },
+    };
+    int count = sizeof(rects) / sizeof(rects[0]);
+    int failed = -1;
+    int layers = texture_atlas_pack(rects, count, ATLAS_CHECK_PAGE, ATLAS_CHECK_PADDING, 1, &failed);
+    if (layers != 1)
+        atlas_fail("single page layers", layers);
+    else
+        atlas_check_placement(rects, count, layers, ATLAS_CHECK_PADDING);
+
+    // four pages worth of sprites, a 2D atlas runs out, an array spills into more layers
+    texture_atlas_rect many[16];
+    for (int i = 0; i < 16; i++)
+        many[i] = (texture_atlas_rect) { .width = 28, .height = 28 };
+    if (texture_atlas_pack(many, 16, ATLAS_CHECK_PAGE, ATLAS_CHECK_PADDING, 1, &failed) != -1 || failed < 0 || failed >= 16)
+        atlas_fail("full 2D page not reported, failed", failed);
+
+    layers = texture_atlas_pack(many, 16, ATLAS_CHECK_PAGE, ATLAS_CHECK_PADDING, 16, &failed);
+    if (layers != 4)
+        atlas_fail("array layers", layers);
+    else
+        atlas_check_placement(many, 16, layers, ATLAS_CHECK_PADDING);
+
+    // the padding counts towards the page size
+    texture_atlas_rect large = { .width = ATLAS_CHECK_PAGE - 2 * ATLAS_CHECK_PADDING + 1, .height = 4 };
+    failed = -1;
+    if (texture_atlas_pack(&large, 1, ATLAS_CHECK_PAGE, ATLAS_CHECK_PADDING, 16, &failed) != -1 || failed != 0)
+        atlas_fail("oversized sprite packed, failed", failed);
+}
+
+static void atlas_check_blit(void)
+{
+    enum { WIDTH = 3, HEIGHT = 2, PADDING = ATLAS_CHECK_PADDING };
+    unsigned char pixels[WIDTH * HEIGHT * 4];
+    for (int i = 0; i < WIDTH * HEIGHT * 4; i++)
+        pixels[i] = (unsigned char) (i * 7 + 1);
+
+    unsigned char page[ATLAS_CHECK_PAGE * ATLAS_CHECK_PAGE * 4];
+    memset(page, 0xee, sizeof(page));
+    texture_atlas_rect rect = { .width = WIDTH, .height = HEIGHT, .x = 5, .y = 9 };
+    texture_atlas_blit(&rect, pixels, PADDING, page, ATLAS_CHECK_PAGE);
+
+    for (int y = 0; y < ATLAS_CHECK_PAGE; y++)
+        for (int x = 0; x < ATLAS_CHECK_PAGE; x++)
+        {
+            const unsigned char* texel = page + (y * ATLAS_CHECK_PAGE + x) * 4;
+            int px = x - rect.x - PADDING;
+            int py = y - rect.y - PADDING;
+            unsigned char expected[4] = { 0xee, 0xee, 0xee, 0xee };
+
+            // inside the padded area texels repeat the nearest sprite texel
+            if (px >= -PADDING && px < WIDTH + PADDING && py >= -PADDING && py < HEIGHT + PADDING)
+            {
+                px = px < 0 ? 0 : (px >= WIDTH ? WIDTH - 1 : px);
+                py = py < 0 ? 0 : (py >= HEIGHT ? HEIGHT - 1 : py);
+                memcpy(expected, pixels + (py * WIDTH + px) * 4, 4);
+            }
+
+            if (memcmp(texel, expected, 4) != 0)
+            {
+                atlas_fail("blit texel mismatch at", y * ATLAS_CHECK_PAGE + x);
+                return;
+            }
+        }
+}
+
+static void atlas_check_mip_levels(void)
+{
+    // padding p keeps levels whose texels average at most p source texels
+    const int expected[][3] = { { 64, 0, 1 }, { 64, 1, 1 }, { 64, 2, 2 }, { 64, 3, 2 }, { 64, 4, 3 }, { 64, 16, 5 }, { 4, 64, 3 } };
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++)
+    {
+        int levels = texture_atlas_mip_levels(expected[i][0], expected[i][1]);
+        if (levels != expected[i][2])
+            atlas_fail("mip levels for padding", expected[i][1]);
+    }
+}
+
+int main(void)
+{
+    atlas_check_pack();
+    atlas_check_blit();
+    atlas_check_mip_levels();
+    my_log_if(failures == 0, SCCSMSG("atlas packing ok\n"));
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,263 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/bc.h"
+#include "../src/ktx2.h"
+#include "../src/mipmap.h"
+
+#define ENABLE_LOGS
+#include "../src/debug.h"
+
+/**
+ * CPU round trip of the texture codecs, no GL context needed
+ * usage: codec_check
+ *
+ * every block format encodes and decodes solid, gradient and edge-padded images within its error bound,
+ * then a compressed chain goes through ktx2_write and ktx2_map and has to come back byte for byte,
+ * and only match loads asking for its color space and row order
+ * exits with failure on the first mismatch
+ */
+
+#define CODEC_CHECK_KTX2_PATH "bin/codec_check.ktx2"
+
+typedef struct codec_format
+{
+    bc_format format;
+    const char* name;
+    uint32_t vk_format;
+    uint32_t srgb_vk_format;
+    // largest error of any channel on smooth content, alpha is not checked when it is dropped
+    int max_error;
+    bool has_alpha;
+} codec_format;
+
+static const codec_format codec_formats[] = {
+    { BC_FORMAT_BC1, "BC1", KTX2_VK_FORMAT_BC1_RGB_UNORM, KTX2_VK_FORMAT_BC1_RGB_SRGB, 12, false },
+    { BC_FORMAT_BC3, "BC3", KTX2_VK_FORMAT_BC3_UNORM, KTX2_VK_FORMAT_BC3_SRGB, 12, true },
+    { BC_FORMAT_BC7, "BC7", KTX2_VK_FORMAT_BC7_UNORM, KTX2_VK_FORMAT_BC7_SRGB, 6, true },
+};
+
+static int failures;
+
+static void codec_fail(const char* what, const codec_format* format, int value)
+{
+    my_log(ERRMSG("%s %s: %d\n"), format->name, what, value);
+    failures++;
+}
+
+/**
+ * largest channel difference of a decoded block
+ */
+static int codec_block_error(const codec_format* format, const unsigned char expected[64], const unsigned char actual[64])
+{
+    int error = 0;
+    for (int i = 0; i < 64; i++)
+    {
+        if (i % 4 == 3 && !format->has_alpha)
+            continue;
+        int difference = abs(expected[i] - actual[i]);
+        error = difference > error ? difference : error;
+    }
+    return error;
+}
+
+static int codec_round_trip(const codec_format* format, const unsigned char rgba[64])
+{
+    unsigned char block[16];
+    unsigned char decoded[64];
+    bc_encode_block(format->format, rgba, block);
+    bc_decode_block(format->format, block, decoded);
+
+    // BC1 drops alpha, the decoder has to report opaque texels
+    if (!format->has_alpha)
+        for (int i = 3; i < 64; i += 4)
+            if (decoded[i] != 255)
+                return 255;
+
+    return codec_block_error(format, rgba, decoded);
+}
+
+static void codec_check_blocks(const codec_format* format)
+{
+    unsigned char rgba[64];
+    int worst = 0;
+
+    // solid blocks across the whole range
+    for (int value = 0; value < 256; value += 5)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            rgba[i * 4 + 0] = value;
+            rgba[i * 4 + 1] = 255 - value;
+            rgba[i * 4 + 2] = value / 2;
+            rgba[i * 4 + 3] = 255 - value / 3;
+        }
+        int error = codec_round_trip(format, rgba);
+        worst = error > worst ? error : worst;
+    }
+
+    // diagonal gradients, colors on a line through RGB space as block compression expects
+    for (int start = 0; start < 192; start += 17)
+    {
+        for (int y = 0; y < 4; y++)
+            for (int x = 0; x < 4; x++)
+            {
+                unsigned char* texel = rgba + (y * 4 + x) * 4;
+                int t = (x + y) * 8;
+                texel[0] = start + t;
+                texel[1] = 200 - start / 2 - t / 2;
+                texel[2] = start / 3 + t;
+                texel[3] = 255 - start / 2 - t;
+            }
+        int error = codec_round_trip(format, rgba);
+        worst = error > worst ? error : worst;
+    }
+
+    if (worst > format->max_error)
+        codec_fail("block error above bound", format, worst);
+}
+
+/**
+ * image whose size is not a multiple of 4, every texel of the decoded blocks is compared,
+ * padding texels repeat the last row and column
+ */
+static void codec_check_image(const codec_format* format)
+{
+    enum { WIDTH = 13, HEIGHT = 6 };
+    unsigned char rgba[WIDTH * HEIGHT * 4];
+    for (int y = 0; y < HEIGHT; y++)
+        for (int x = 0; x < WIDTH; x++)
+        {
+            unsigned char* texel = rgba + (y * WIDTH + x) * 4;
+            int t = x * 6 + y * 3;
+            texel[0] = 40 + t;
+            texel[1] = 200 - t;
+            texel[2] = 90;
+            texel[3] = 160 + t;
+        }
+
+    size_t size = bc_image_size(format->format, WIDTH, HEIGHT);
+    size_t expected_size = (size_t) ((WIDTH + 3) / 4) * ((HEIGHT + 3) / 4) * bc_block_size(format->format);
+    if (size != expected_size)
+    {
+        codec_fail("image size", format, (int) size);
+        return;
+    }
+
+    unsigned char* blocks = malloc(size);
+    my_assert(blocks, "failed to allocate blocks");
+    bc_encode_image(format->format, rgba, WIDTH, HEIGHT, blocks);
+
+    int worst = 0;
+    const unsigned char* block = blocks;
+    for (int by = 0; by < (HEIGHT + 3) / 4; by++)
+        for (int bx = 0; bx < (WIDTH + 3) / 4; bx++, block += bc_block_size(format->format))
+        {
+            unsigned char expected[64];
+            unsigned char decoded[64];
+            for (int i = 0; i < 16; i++)
+            {
+                int x = bx * 4 + i % 4 < WIDTH ? bx * 4 + i % 4 : WIDTH - 1;
+                int y = by * 4 + i / 4 < HEIGHT ? by * 4 + i / 4 : HEIGHT - 1;
+                memcpy(expected + i * 4, rgba + (y * WIDTH + x) * 4, 4);
+            }
+            bc_decode_block(format->format, block, decoded);
+            int error = codec_block_error(format, expected, decoded);
+            worst = error > worst ? error : worst;
+        }
+    free(blocks);
+
+    if (worst > format->max_error)
+        codec_fail("image error above bound", format, worst);
+}
+
+/**
+ * compressed mip chain written and mapped back, levels and metadata must survive unchanged
+ */
+static void codec_check_ktx2(const codec_format* format)
+{
+    enum { SIZE = 20 };
+    mip_chain chain = { .channels = 0 };
+    for (int i = 0; SIZE >> i > 0 && i < MIPMAP_MAX_LEVELS; i++, chain.level_count++)
+    {
+        int size = SIZE >> i;
+        chain.levels[i] = (mip_level) { .offset = chain.size, .size = bc_image_size(format->format, size, size), .width = size, .height = size };
+        chain.size += chain.levels[i].size;
+    }
+
+    chain.data = malloc(chain.size);
+    my_assert(chain.data, "failed to allocate chain");
+    for (size_t i = 0; i < chain.size; i++)
+        chain.data[i] = (unsigned char) (i * 31 + 7);
+
+    const uint64_t source_hash = 0x0123456789abcdefull;
+    for (int bottom_up = 0; bottom_up < 2; bottom_up++)
+    {
+        ktx2_file file;
+        if (!ktx2_write(CODEC_CHECK_KTX2_PATH, format->vk_format, bottom_up, source_hash, &chain) || !ktx2_map(CODEC_CHECK_KTX2_PATH, &file))
+        {
+            codec_fail("ktx2 write/map failed, bottom up", format, bottom_up);
+            continue;
+        }
+
+        if (file.vk_format != format->vk_format || file.bottom_up != (bool) bottom_up || file.source_hash != source_hash)
+            codec_fail("ktx2 metadata mismatch, bottom up", format, bottom_up);
+        else if (!ktx2_matches(&file, false, bottom_up) || ktx2_matches(&file, false, !bottom_up))
+            codec_fail("ktx2 row order not matched, bottom up", format, bottom_up);
+        else if (file.chain.level_count != chain.level_count)
+            codec_fail("ktx2 level count", format, file.chain.level_count);
+        else
+            for (int i = 0; i < chain.level_count; i++)
+            {
+                const mip_level* written = &chain.levels[i];
+                const mip_level* mapped = &file.chain.levels[i];
+                if (mapped->width != written->width || mapped->height != written->height || mapped->size != written->size
+                    || memcmp(file.chain.data + mapped->offset, chain.data + written->offset, written->size) != 0)
+                    codec_fail("ktx2 level mismatch", format, i);
+            }
+        ktx2_unmap(&file);
+    }
+
+    // the sRGB variant of the format must only serve sRGB loads, the linear one only linear loads
+    ktx2_file file;
+    if (!ktx2_write(CODEC_CHECK_KTX2_PATH, format->srgb_vk_format, true, source_hash, &chain) || !ktx2_map(CODEC_CHECK_KTX2_PATH, &file))
+        codec_fail("ktx2 sRGB write/map failed", format, 0);
+    else
+    {
+        if (!ktx2_matches(&file, true, true) || ktx2_matches(&file, false, true))
+            codec_fail("ktx2 sRGB file served to a linear load", format, (int) file.vk_format);
+        ktx2_unmap(&file);
+    }
+
+    free(chain.data);
+    remove(CODEC_CHECK_KTX2_PATH);
+}
+
+int main(void)
+{
+    for (size_t i = 0; i < sizeof(codec_formats) / sizeof(codec_formats[0]); i++)
+    {
+        const codec_format* format = &codec_formats[i];
+        int before = failures;
+        codec_check_blocks(format);
+        codec_check_image(format);
+        codec_check_ktx2(format);
+        my_log_if(failures == before, SCCSMSG("%s") " round trip ok\n", format->name);
+    }
+
+    char path[64];
+    // sources differing only in extension get their own compressed files
+    char other_path[64];
+    ktx2_path("textures/wall.v2.jpg", path, sizeof(path));
+    ktx2_path("textures/wall.v2.png", other_path, sizeof(other_path));
+    if (strcmp(path, "textures/wall.v2.jpg.ktx2") != 0 || strcmp(path, other_path) == 0)
+    {
+        my_log(ERRMSG("ktx2 path: %s\n"), path);
+        failures++;
+    }
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,397 @@
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <glad/glad.h>
+
+#include <glob.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../src/vendor/stb_image.h"
+
+#include "../src/gl_ext.h"
+#include "../src/mipmap.h"
+#include "../src/pixel.h"
+#include "../src/texture.h"
+
+#define ENABLE_LOGS
+#include "../src/debug.h"
+
+/**
+ * texture path benchmark on a headless GL context (EGL, Mesa's surfaceless platform when available)
+ * usage: texture_bench [-i iterations] [-g size]... [-n] [image...]
+ *   -i  runs per stage, the fastest one is reported (default 5)
+ *   -g  adds a generated RGBA image of size x size, default corpus adds 2048 and 4096
+ *   -n  no generated images
+ * without images the corpus is every PNG and JPEG in resources/textures
+ *
+ * stages per image: decode (stb_image), flip (pixel module), CPU mip chain, base level upload,
+ * glGenerateMipmap and upload of the full chain the way texture.c does it
+ * then the whole corpus goes through the texture system cold and with a warm cache
+ */
+
+#define BENCH_DEFAULT_ITERATIONS 5
+#define BENCH_MAX_GENERATED 8
+#define BENCH_MB (1024.0 * 1024.0)
+
+typedef struct bench_image
+{
+    const char* name;
+    unsigned char* source;  // encoded file, NULL for generated images
+    size_t source_size;
+    unsigned char* pixels;  // decoded top-down rows
+    int width;
+    int height;
+    int channels;
+} bench_image;
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double bench_mb_per_s(size_t bytes, double seconds)
+{
+    return seconds > 0.0 ? bytes / BENCH_MB / seconds : 0.0;
+}
+
+static bool bench_init_gl(void)
+{
+    EGLDisplay display = EGL_NO_DISPLAY;
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (get_platform_display)
+        display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major, minor;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor) || !eglBindAPI(EGL_OPENGL_API))
+        return false;
+
+    // newest core context first, 3.3 is what the application asks for
+    static const EGLint versions[][2] = { { 4, 6 }, { 4, 5 }, { 4, 2 }, { 3, 3 } };
+    EGLContext context = EGL_NO_CONTEXT;
+    for (size_t i = 0; i < sizeof(versions) / sizeof(versions[0]) && context == EGL_NO_CONTEXT; i++)
+    {
+        const EGLint attributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, versions[i][0],
+            EGL_CONTEXT_MINOR_VERSION, versions[i][1],
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attributes);
+    }
+
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+        return false;
+
+    if (!gladLoadGLLoader((GLADloadproc) eglGetProcAddress))
+        return false;
+    gl_ext_init((GLADloadproc) eglGetProcAddress);
+
+    my_log(INFOMSG("renderer: %s\n"), (const char*) glGetString(GL_RENDERER));
+    return true;
+}
+
+static unsigned char* bench_read_file(const char* path, size_t* size)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+        return NULL;
+
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    unsigned char* data = length > 0 ? malloc(length) : NULL;
+    if (data && fread(data, 1, length, file) != (size_t) length)
+    {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+
+    *size = length > 0 ? (size_t) length : 0;
+    return data;
+}
+
+/**
+ * smooth gradients with noise on top, compresses and filters like a photo rather than a flat fill
+ */
+static void bench_generate(bench_image* image, int size)
+{
+    char* name = malloc(32);
+    snprintf(name, 32, "generated %dx%d", size, size);
+
+    image->name = name;
+    image->width = image->height = size;
+    image->channels = 4;
+    image->pixels = malloc((size_t) size * size * 4);
+    my_assert(image->pixels, "failed to allocate generated image");
+
+    uint32_t state = 0x9e3779b9u;
+    for (int y = 0; y < size; y++)
+    {
+        for (int x = 0; x < size; x++)
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            unsigned char* p = image->pixels + ((size_t) y * size + x) * 4;
+            p[0] = (unsigned char) (x * 255 / size + (state & 15));
+            p[1] = (unsigned char) (y * 255 / size + ((state >> 4) & 15));
+            p[2] = (unsigned char) ((x ^ y) + ((state >> 8) & 15));
+            p[3] = (unsigned char) (255 - ((state >> 12) & 63));
+        }
+    }
+}
+
+static GLenum bench_format(int channels)
+{
+    switch (channels)
+    {
+        case 1: return GL_RED;
+        case 2: return GL_RG;
+        case 3: return GL_RGB;
+        default: return GL_RGBA;
+    }
+}
+
+static GLenum bench_internal_format(int channels)
+{
+    switch (channels)
+    {
+        case 1: return GL_R8;
+        case 2: return GL_RG8;
+        case 3: return GL_RGB8;
+        default: return GL_RGBA8;
+    }
+}
+
+typedef struct bench_result
+{
+    double decode;
+    double flip;
+    double mips_cpu;
+    double upload_base;
+    double mips_gl;
+    double upload_chain;
+} bench_result;
+
+#define BENCH_KEEP_MIN(field, value) if ((value) < result->field) result->field = (value)
+
+static void bench_run_image(bench_image* image, int iterations, bench_result* result)
+{
+    size_t bytes = (size_t) image->width * image->height * image->channels;
+    GLenum format = bench_format(image->channels);
+    GLenum internal_format = bench_internal_format(image->channels);
+
+    *result = (bench_result) { 1e9, 1e9, 1e9, 1e9, 1e9, 1e9 };
+    if (image->source == NULL)
+        result->decode = 0.0;
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    for (int i = 0; i < iterations; i++)
+    {
+        double start = bench_now();
+        if (image->source)
+        {
+            int width, height, channels;
+            unsigned char* pixels = stbi_load_from_memory(image->source, (int) image->source_size, &width, &height, &channels, 0);
+            my_assert(pixels, stbi_failure_reason());
+            BENCH_KEEP_MIN(decode, bench_now() - start);
+            stbi_image_free(pixels);
+        }
+
+        // twice brings the rows back for the next stage
+        start = bench_now();
+        pixel_flip_vertical(image->pixels, image->width, image->height, image->channels);
+        BENCH_KEEP_MIN(flip, bench_now() - start);
+        pixel_flip_vertical(image->pixels, image->width, image->height, image->channels);
+
+        mip_chain chain;
+        start = bench_now();
+        my_assert(mip_chain_generate(&chain, image->pixels, image->width, image->height, image->channels, false), "failed to generate mip chain");
+        BENCH_KEEP_MIN(mips_cpu, bench_now() - start);
+
+        GLuint textures[2];
+        glGenTextures(2, textures);
+        glFinish();
+
+        // what main() used to do: one mutable level, mips by the driver
+        glBindTexture(GL_TEXTURE_2D, textures[0]);
+        start = bench_now();
+        glTexImage2D(GL_TEXTURE_2D, 0, internal_format, image->width, image->height, 0, format, GL_UNSIGNED_BYTE, image->pixels);
+        glFinish();
+        BENCH_KEEP_MIN(upload_base, bench_now() - start);
+
+        start = bench_now();
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glFinish();
+        BENCH_KEEP_MIN(mips_gl, bench_now() - start);
+
+        // what texture.c does: immutable storage filled with the CPU built chain
+        glBindTexture(GL_TEXTURE_2D, textures[1]);
+        start = bench_now();
+        if (gl_ext.tex_storage_2d)
+            gl_ext.tex_storage_2d(GL_TEXTURE_2D, chain.level_count, internal_format, image->width, image->height);
+        for (int level = 0; level < chain.level_count; level++)
+        {
+            const mip_level* l = &chain.levels[level];
+            if (gl_ext.tex_storage_2d)
+                glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, l->width, l->height, format, GL_UNSIGNED_BYTE, chain.data + l->offset);
+            else
+                glTexImage2D(GL_TEXTURE_2D, level, internal_format, l->width, l->height, 0, format, GL_UNSIGNED_BYTE, chain.data + l->offset);
+        }
+        glFinish();
+        BENCH_KEEP_MIN(upload_chain, bench_now() - start);
+
+        glDeleteTextures(2, textures);
+        mip_chain_free(&chain);
+        gl_check_error();
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    char decode[32] = "-";
+    if (image->source)
+        snprintf(decode, sizeof(decode), "%9.1f", bench_mb_per_s(bytes, result->decode));
+
+    printf("%-40s %5dx%-5d %d  %9s %9.1f %9.2f %9.1f %9.2f %9.1f\n",
+           image->name, image->width, image->height, image->channels, decode,
+           bench_mb_per_s(bytes, result->flip),
+           result->mips_cpu * 1e3,
+           bench_mb_per_s(bytes, result->upload_base),
+           result->mips_gl * 1e3,
+           bench_mb_per_s(bytes * 4 / 3, result->upload_chain));
+}
+
+/**
+ * whole corpus through texture_load_async() + texture_wait_all(), returns seconds
+ */
+static double bench_run_system(bench_image* images, int count, bool use_cache)
+{
+    texture_system_init(0);
+    texture_streaming_init(TEXTURE_STREAM_SLOTS, TEXTURE_STREAM_SLOT_SIZE);
+
+    texture_params params = TEXTURE_PARAMS_DEFAULT;
+    params.use_cache = use_cache;
+    params.use_compressed = false;
+
+    double start = bench_now();
+    for (int i = 0; i < count; i++)
+        if (images[i].source)
+            texture_load_async(images[i].name, params);
+    texture_wait_all();
+    glFinish();
+    double elapsed = bench_now() - start;
+
+    texture_system_shutdown();
+    return elapsed;
+}
+
+int main(int argc, char** argv)
+{
+    int iterations = BENCH_DEFAULT_ITERATIONS;
+    int generated[BENCH_MAX_GENERATED];
+    int generated_count = 0;
+    bool no_generated = false;
+    const char** paths = calloc(argc, sizeof(char*));
+    int path_count = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-i") == 0 && i + 1 < argc)
+            iterations = atoi(argv[++i]) > 0 ? atoi(argv[i]) : 1;
+        else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc && generated_count < BENCH_MAX_GENERATED)
+            generated[generated_count++] = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-n") == 0)
+            no_generated = true;
+        else
+            paths[path_count++] = argv[i];
+    }
+
+    glob_t corpus = {0};
+    if (path_count == 0)
+    {
+        glob("./resources/textures/*.png", 0, NULL, &corpus);
+        glob("./resources/textures/*.jpg", GLOB_APPEND, NULL, &corpus);
+        paths = realloc(paths, sizeof(char*) * (corpus.gl_pathc + 1));
+        for (size_t i = 0; i < corpus.gl_pathc; i++)
+            paths[path_count++] = corpus.gl_pathv[i];
+    }
+    if (generated_count == 0 && !no_generated)
+    {
+        generated[generated_count++] = 2048;
+        generated[generated_count++] = 4096;
+    }
+    if (no_generated)
+        generated_count = 0;
+
+    my_assert(bench_init_gl(), "failed to create headless GL context");
+
+    bench_image* images = calloc(path_count + generated_count, sizeof(bench_image));
+    int image_count = 0;
+    int file_count = 0;
+
+    for (int i = 0; i < path_count; i++)
+    {
+        bench_image* image = &images[image_count];
+        image->name = paths[i];
+        image->source = bench_read_file(paths[i], &image->source_size);
+        if (image->source)
+            image->pixels = stbi_load_from_memory(image->source, (int) image->source_size, &image->width, &image->height, &image->channels, 0);
+        if (image->pixels == NULL)
+        {
+            my_log(ERRMSG("failed to load image: ") PATHMSG("%s\n"), paths[i]);
+            free(image->source);
+            continue;
+        }
+        image_count++;
+        file_count++;
+    }
+    for (int i = 0; i < generated_count; i++)
+        bench_generate(&images[image_count++], generated[i]);
+
+    printf("%-40s %11s %s  %9s %9s %9s %9s %9s %9s\n", "image", "size", "c",
+           "dec MB/s", "flip MB/s", "mips ms", "up MB/s", "glmip ms", "chain MB/s");
+
+    for (int i = 0; i < image_count; i++)
+    {
+        bench_result result;
+        bench_run_image(&images[i], iterations, &result);
+    }
+
+    // first run writes the cache, second one maps it
+    if (file_count > 0)
+    {
+        double cold = bench_run_system(images, image_count, false);
+        bench_run_system(images, image_count, true);
+        double warm = bench_run_system(images, image_count, true);
+        printf("\ntexture system, %d files: %.2f ms decoding, %.2f ms from cache\n", file_count, cold * 1e3, warm * 1e3);
+    }
+
+    for (int i = 0; i < image_count; i++)
+    {
+        if (images[i].source)
+        {
+            free(images[i].source);
+            stbi_image_free(images[i].pixels);
+        }
+        else
+        {
+            free((char*) images[i].name);
+            free(images[i].pixels);
+        }
+    }
+    free(images);
+    free(paths);
+    globfree(&corpus);
+    return EXIT_SUCCESS;
+}
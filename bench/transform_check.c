@@ -0,0 +1,148 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/transform_kernels.h"
+
+#define ENABLE_LOGS
+#include "../src/debug.h"
+
+/**
+ * CPU check of the transform kernels, no GL context needed
+ * usage: transform_check
+ *
+ * every kernel this CPU can run has to match the scalar kernels on the same batch of models,
+ * including a non-uniformly scaled one and a singular one whose normal matrix must come out zero,
+ * in place products must match out of place ones and normal stores must stay inside the output
+ * exits with failure on the first mismatch
+ */
+
+#define TRANSFORM_CHECK_MODELS 5
+// relative to the largest element of the compared matrix
+#define TRANSFORM_CHECK_TOLERANCE 1e-5f
+
+static int failures;
+
+static void transform_fail(const char* what, const transform_kernel* kernel, int value)
+{
+    my_log(ERRMSG("%s %s: %d\n"), kernel->name, what, value);
+    failures++;
+}
+
+/**
+ * index of the first element differing by more than the tolerance, -1 when all match
+ */
+static int transform_compare(const float* expected, const float* actual, int count)
+{
+    float scale = 1.0f;
+    for (int i = 0; i < count; i++)
+        scale = fabsf(expected[i]) > scale ? fabsf(expected[i]) : scale;
+
+    for (int i = 0; i < count; i++)
+        if (!(fabsf(expected[i] - actual[i]) <= TRANSFORM_CHECK_TOLERANCE * scale))
+            return i;
+    return -1;
+}
+
+/**
+ * column major models: identity, rotation with translation, non-uniform scale with shear,
+ * a general affine one and a singular one flattened along z
+ */
+static void transform_check_models(float* models)
+{
+    static const float columns[TRANSFORM_CHECK_MODELS][16] = {
+        { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 },
+        { 0.8f, 0.6f, 0, 0, -0.6f, 0.8f, 0, 0, 0, 0, 1, 0, 3, -2, 5, 1 },
+        { 2, 0, 0, 0, 0.5f, 0.25f, 0, 0, 0, 0, 7, 0, 0, 0, 0, 1 },
+        { 1.5f, -0.3f, 0.2f, 0, 0.4f, 2.2f, -0.7f, 0, -0.1f, 0.9f, 3.1f, 0, -4, 0.5f, 12, 1 },
+        { 1, 2, 0, 0, 3, -1, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1 },
+    };
+    memcpy(models, columns, sizeof(columns));
+}
+
+static void transform_check_mvp(const transform_kernel* reference, const transform_kernel* kernel, const float* models)
+{
+    // perspective projection times a view with rotation and translation
+    static const float view_projection[16] = {
+        1.3f, 0.1f, -0.2f, -0.2f, -0.05f, 1.7f, 0.3f, 0.3f, 0.4f, -0.2f, -1.0f, -1.0f, 2.0f, -3.0f, 4.8f, 5.0f,
+    };
+
+    float expected[TRANSFORM_CHECK_MODELS * 16];
+    float actual[TRANSFORM_CHECK_MODELS * 16];
+    reference->mvp_batch(view_projection, models, expected, TRANSFORM_CHECK_MODELS);
+    kernel->mvp_batch(view_projection, models, actual, TRANSFORM_CHECK_MODELS);
+
+    for (int i = 0; i < TRANSFORM_CHECK_MODELS; i++)
+    {
+        int element = transform_compare(expected + i * 16, actual + i * 16, 16);
+        if (element >= 0)
+            transform_fail("mvp mismatch, model", kernel, i);
+    }
+
+    // out may be models
+    memcpy(actual, models, sizeof(actual));
+    kernel->mvp_batch(view_projection, actual, actual, TRANSFORM_CHECK_MODELS);
+    if (transform_compare(expected, actual, TRANSFORM_CHECK_MODELS * 16) >= 0)
+        transform_fail("in place mvp mismatch, element", kernel, transform_compare(expected, actual, TRANSFORM_CHECK_MODELS * 16));
+}
+
+static void transform_check_normals(const transform_kernel* reference, const transform_kernel* kernel, const float* models)
+{
+    enum { GUARD = 4 };
+    float expected[TRANSFORM_CHECK_MODELS * 9];
+    float actual[TRANSFORM_CHECK_MODELS * 9 + GUARD];
+    for (int i = 0; i < TRANSFORM_CHECK_MODELS * 9 + GUARD; i++)
+        actual[i] = -123.0f;
+
+    reference->normal_batch(models, expected, TRANSFORM_CHECK_MODELS);
+    kernel->normal_batch(models, actual, TRANSFORM_CHECK_MODELS);
+
+    for (int i = 0; i < TRANSFORM_CHECK_MODELS; i++)
+        if (transform_compare(expected + i * 9, actual + i * 9, 9) >= 0)
+            transform_fail("normal matrix mismatch, model", kernel, i);
+
+    for (int i = 0; i < GUARD; i++)
+        if (actual[TRANSFORM_CHECK_MODELS * 9 + i] != -123.0f)
+            transform_fail("normal matrix stored past the output, float", kernel, i);
+
+    // the last model is singular
+    for (int i = 0; i < 9; i++)
+        if (actual[(TRANSFORM_CHECK_MODELS - 1) * 9 + i] != 0.0f)
+        {
+            transform_fail("singular model has a non-zero normal matrix, element", kernel, i);
+            break;
+        }
+}
+
+int main(void)
+{
+    float models[TRANSFORM_CHECK_MODELS * 16];
+    transform_check_models(models);
+
+    const transform_kernel* kernels;
+    int count = transform_kernels_available(&kernels);
+
+    // the scalar kernels are checked against the identity and the inverse transpose identity
+    float product[16];
+    kernels[0].mvp_batch(models, models + 16, product, 1);
+    if (transform_compare(models + 16, product, 16) >= 0)
+        transform_fail("identity product mismatch, element", &kernels[0], transform_compare(models + 16, product, 16));
+
+    float normal[9];
+    kernels[0].normal_batch(models + 16, normal, 1);
+    for (int col = 0; col < 3; col++)
+        if (transform_compare(models + 16 + col * 4, normal + col * 3, 3) >= 0)
+            transform_fail("rotation normal matrix mismatch, column", &kernels[0], col);
+
+    for (int i = 0; i < count; i++)
+    {
+        int before = failures;
+        transform_check_mvp(&kernels[0], &kernels[i], models);
+        transform_check_normals(&kernels[0], &kernels[i], models);
+        my_log_if(failures == before, SCCSMSG("%s") " transform kernels ok\n", kernels[i].name);
+    }
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
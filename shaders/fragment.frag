@@ -1,12 +1,16 @@
 #version 330 core
+#include "spirv.glsl"
 
 out vec4 FragColor;
 in vec2 texCoord;
 in vec3 color;
 
-uniform sampler2D texture1;
+UNIFORM_LOCATION(3) uniform sampler2D texture1;
 
 void main()
 {
     FragColor = texture(texture1, texCoord);
+#ifdef VERTEX_COLOR
+    FragColor *= vec4(color, 1.0);
+#endif
 } 
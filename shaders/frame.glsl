@@ -0,0 +1,11 @@
+// shared by all programs, updated once per frame (src/frame_uniforms.h)
+// binding 0 is FRAME_UNIFORMS_BINDING
+UNIFORM_BLOCK(0) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    mat4 view_projection;
+    float time;
+    float delta_time;
+    vec2 viewport;
+};
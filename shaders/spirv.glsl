@@ -0,0 +1,11 @@
+// glslang compiles these sources to SPIR-V for ARB_gl_spirv (make spirv), where nothing is bound by name:
+// uniforms with an id in src/shader_reflection.h sit at layout(location = <id>), blocks at fixed bindings
+#ifdef GL_SPIRV
+#extension GL_ARB_explicit_uniform_location : require
+#extension GL_ARB_shading_language_420pack : require
+#define UNIFORM_LOCATION(n) layout(location = n)
+#define UNIFORM_BLOCK(n) layout(std140, binding = n)
+#else
+#define UNIFORM_LOCATION(n)
+#define UNIFORM_BLOCK(n) layout(std140)
+#endif
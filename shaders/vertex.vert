@@ -1,11 +1,19 @@
 #version 330 core
+#include "spirv.glsl"
+
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aColor;
 layout (location = 2) in vec2 aTexCoord;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "frame.glsl"
+#include "vertex_format.glsl"
+
+#ifdef PRECOMPUTED_MVP
+// view_projection*model computed once per object on the CPU
+UNIFORM_LOCATION(4) uniform mat4 mvp;
+#else
+UNIFORM_LOCATION(0) uniform mat4 model;
+#endif
 
 out vec2 texCoord;
 out vec3 color;
@@ -14,5 +22,9 @@ void main()
 {
     color = aColor;
     texCoord = aTexCoord;
-    gl_Position = projection*view*model*vec4(aPos, 1);
+#ifdef PRECOMPUTED_MVP
+    gl_Position = mvp*vec4(decode_position(aPos), 1);
+#else
+    gl_Position = view_projection*model*vec4(decode_position(aPos), 1);
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,25 @@
+// decoding of the compact vertex formats, see src/vertex_format.h
+
+#ifdef QUANTIZED_POSITION
+// per mesh, stored position * scale + offset
+UNIFORM_LOCATION(6) uniform vec3 position_scale;
+UNIFORM_LOCATION(7) uniform vec3 position_offset;
+#endif
+
+vec3 decode_position(vec3 position)
+{
+#ifdef QUANTIZED_POSITION
+    return position*position_scale + position_offset;
+#else
+    return position;
+#endif
+}
+
+// octahedral normal, both components come in as normalized snorm16
+vec3 decode_octahedral_normal(vec2 encoded)
+{
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-normal.z, 0.0);
+    normal.xy += vec2(normal.x >= 0.0 ? -fold : fold, normal.y >= 0.0 ? -fold : fold);
+    return normalize(normal);
+}
@@ -0,0 +1,498 @@
+#include "bc.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// BC7 4-bit index interpolation weights (out of 64)
+static const int bc7_weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+size_t bc_block_size(bc_format format)
+{
+    return format == BC_FORMAT_BC1 ? 8 : 16;
+}
+
+size_t bc_image_size(bc_format format, int width, int height)
+{
+    size_t blocks_x = (width + 3) / 4;
+    size_t blocks_y = (height + 3) / 4;
+    return blocks_x * blocks_y * bc_block_size(format);
+}
+
+static int bc_clamp255(float v)
+{
+    int i = (int) lrintf(v);
+    return i < 0 ? 0 : (i > 255 ? 255 : i);
+}
+
+/**
+ * endpoints along the principal axis of the block, channels is 3 (RGB) or 4 (RGBA)
+ */
+static void bc_fit_endpoints(const unsigned char rgba[64], int channels, int lo[4], int hi[4])
+{
+    float mean[4] = {0};
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < channels; c++)
+            mean[c] += rgba[i * 4 + c];
+    for (int c = 0; c < channels; c++)
+        mean[c] /= 16.0f;
+
+    float cov[4][4] = {{0}};
+    for (int i = 0; i < 16; i++)
+    {
+        float d[4];
+        for (int c = 0; c < channels; c++)
+            d[c] = rgba[i * 4 + c] - mean[c];
+        for (int a = 0; a < channels; a++)
+            for (int b = 0; b < channels; b++)
+                cov[a][b] += d[a] * d[b];
+    }
+
+    // power iteration converges to the dominant eigenvector within a few steps
+    // it starts from the channel that varies most, a fixed start like (1, 1, 1) is orthogonal to
+    // the axis of anti-correlated channels (red rising while green falls) and would collapse the block
+    int widest = 0;
+    for (int c = 1; c < channels; c++)
+        widest = cov[c][c] > cov[widest][widest] ? c : widest;
+    float axis[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    axis[widest] = 1.0f;
+    for (int iter = 0; iter < 8; iter++)
+    {
+        float next[4] = {0};
+        float length = 0.0f;
+        for (int a = 0; a < channels; a++)
+        {
+            for (int b = 0; b < channels; b++)
+                next[a] += cov[a][b] * axis[b];
+            length += next[a] * next[a];
+        }
+        if (length < 1e-12f)
+            break;
+        length = 1.0f / sqrtf(length);
+        for (int a = 0; a < channels; a++)
+            axis[a] = next[a] * length;
+    }
+
+    float t_min = INFINITY, t_max = -INFINITY;
+    for (int i = 0; i < 16; i++)
+    {
+        float t = 0.0f;
+        for (int c = 0; c < channels; c++)
+            t += (rgba[i * 4 + c] - mean[c]) * axis[c];
+        t_min = t < t_min ? t : t_min;
+        t_max = t > t_max ? t : t_max;
+    }
+
+    for (int c = 0; c < channels; c++)
+    {
+        lo[c] = bc_clamp255(mean[c] + t_min * axis[c]);
+        hi[c] = bc_clamp255(mean[c] + t_max * axis[c]);
+    }
+}
+
+static int bc_distance(const int* a, const unsigned char* b, int channels)
+{
+    int sum = 0;
+    for (int c = 0; c < channels; c++)
+        sum += (a[c] - b[c]) * (a[c] - b[c]);
+    return sum;
+}
+
+static void bc_write16(unsigned char* out, unsigned int v)
+{
+    out[0] = v & 0xff;
+    out[1] = (v >> 8) & 0xff;
+}
+
+static unsigned int bc_read16(const unsigned char* in)
+{
+    return in[0] | (in[1] << 8);
+}
+
+#pragma region BC1
+static unsigned int bc_pack565(const int c[3])
+{
+    unsigned int r = (c[0] * 31 + 127) / 255;
+    unsigned int g = (c[1] * 63 + 127) / 255;
+    unsigned int b = (c[2] * 31 + 127) / 255;
+    return (r << 11) | (g << 5) | b;
+}
+
+static void bc_unpack565(unsigned int v, int c[3])
+{
+    int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+    c[0] = (r << 3) | (r >> 2);
+    c[1] = (g << 2) | (g >> 4);
+    c[2] = (b << 3) | (b >> 2);
+}
+
+static void bc1_palette(unsigned int c0, unsigned int c1, bool four_color, int palette[4][4])
+{
+    bc_unpack565(c0, palette[0]);
+    bc_unpack565(c1, palette[1]);
+    palette[0][3] = palette[1][3] = 255;
+
+    for (int c = 0; c < 3; c++)
+    {
+        if (four_color)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        else
+        {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    palette[2][3] = 255;
+    palette[3][3] = four_color ? 255 : 0;
+}
+
+/**
+ * always emits 4 color mode (c0 > c1) which is also what BC3 color blocks expect
+ */
+static void bc1_encode_color(const unsigned char rgba[64], unsigned char* block)
+{
+    int lo[4], hi[4];
+    bc_fit_endpoints(rgba, 3, lo, hi);
+
+    unsigned int c0 = bc_pack565(hi);
+    unsigned int c1 = bc_pack565(lo);
+    if (c0 < c1)
+    {
+        unsigned int tmp = c0;
+        c0 = c1;
+        c1 = tmp;
+    }
+
+    bc_write16(block, c0);
+    bc_write16(block + 2, c1);
+
+    uint32_t indices = 0;
+    if (c0 != c1)
+    {
+        int palette[4][4];
+        bc1_palette(c0, c1, true, palette);
+
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0, best_distance = bc_distance(palette[0], rgba + i * 4, 3);
+            for (int p = 1; p < 4; p++)
+            {
+                int distance = bc_distance(palette[p], rgba + i * 4, 3);
+                if (distance < best_distance)
+                {
+                    best = p;
+                    best_distance = distance;
+                }
+            }
+            indices |= (uint32_t) best << (i * 2);
+        }
+    }
+
+    for (int i = 0; i < 4; i++)
+        block[4 + i] = (indices >> (i * 8)) & 0xff;
+}
+
+static void bc1_decode_color(const unsigned char* block, bool force_four_color, unsigned char rgba[64])
+{
+    unsigned int c0 = bc_read16(block);
+    unsigned int c1 = bc_read16(block + 2);
+
+    int palette[4][4];
+    bc1_palette(c0, c1, force_four_color || c0 > c1, palette);
+
+    for (int i = 0; i < 16; i++)
+    {
+        int index = (block[4 + i / 4] >> ((i % 4) * 2)) & 3;
+        for (int c = 0; c < 4; c++)
+            rgba[i * 4 + c] = palette[index][c];
+    }
+}
+#pragma endregion
+
+#pragma region BC3
+static void bc4_palette(int a0, int a1, int palette[8])
+{
+    palette[0] = a0;
+    palette[1] = a1;
+    if (a0 > a1)
+    {
+        for (int i = 2; i < 8; i++)
+            palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+    }
+    else
+    {
+        for (int i = 2; i < 6; i++)
+            palette[i] = ((6 - i) * a0 + (i - 1) * a1) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+static void bc4_encode_alpha(const unsigned char rgba[64], unsigned char* block)
+{
+    int a0 = 0, a1 = 255;
+    for (int i = 0; i < 16; i++)
+    {
+        int a = rgba[i * 4 + 3];
+        a0 = a > a0 ? a : a0;
+        a1 = a < a1 ? a : a1;
+    }
+
+    block[0] = a0;
+    block[1] = a1;
+
+    uint64_t indices = 0;
+    if (a0 != a1)
+    {
+        int palette[8];
+        bc4_palette(a0, a1, palette);
+
+        for (int i = 0; i < 16; i++)
+        {
+            int a = rgba[i * 4 + 3];
+            int best = 0, best_distance = 256;
+            for (int p = 0; p < 8; p++)
+            {
+                int distance = abs(palette[p] - a);
+                if (distance < best_distance)
+                {
+                    best = p;
+                    best_distance = distance;
+                }
+            }
+            indices |= (uint64_t) best << (i * 3);
+        }
+    }
+
+    for (int i = 0; i < 6; i++)
+        block[2 + i] = (indices >> (i * 8)) & 0xff;
+}
+
+static void bc4_decode_alpha(const unsigned char* block, unsigned char rgba[64])
+{
+    int palette[8];
+    bc4_palette(block[0], block[1], palette);
+
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; i++)
+        indices |= (uint64_t) block[2 + i] << (i * 8);
+
+    for (int i = 0; i < 16; i++)
+        rgba[i * 4 + 3] = palette[(indices >> (i * 3)) & 7];
+}
+#pragma endregion
+
+#pragma region BC7
+typedef struct bc7_bits
+{
+    unsigned char* data;
+    int position;
+} bc7_bits;
+
+static void bc7_write(bc7_bits* bits, unsigned int value, int count)
+{
+    for (int i = 0; i < count; i++, bits->position++)
+    {
+        if ((value >> i) & 1)
+            bits->data[bits->position / 8] |= 1 << (bits->position % 8);
+    }
+}
+
+static unsigned int bc7_read(bc7_bits* bits, int count)
+{
+    unsigned int value = 0;
+    for (int i = 0; i < count; i++, bits->position++)
+        value |= ((bits->data[bits->position / 8] >> (bits->position % 8)) & 1u) << i;
+    return value;
+}
+
+/**
+ * picks 7 bit endpoint + shared p-bit closest to the 8 bit color
+ */
+static void bc7_quantize_endpoint(const int color[4], int quantized[4], int* pbit)
+{
+    int best_error = -1;
+    for (int p = 0; p < 2; p++)
+    {
+        int candidate[4];
+        int error = 0;
+        for (int c = 0; c < 4; c++)
+        {
+            int q = (color[c] - p + 1) / 2;
+            q = q < 0 ? 0 : (q > 127 ? 127 : q);
+            candidate[c] = q;
+            int value = (q << 1) | p;
+            error += (value - color[c]) * (value - color[c]);
+        }
+        if (best_error < 0 || error < best_error)
+        {
+            best_error = error;
+            *pbit = p;
+            memcpy(quantized, candidate, sizeof(candidate));
+        }
+    }
+}
+
+static void bc7_palette(const int q0[4], int p0, const int q1[4], int p1, int palette[16][4])
+{
+    for (int c = 0; c < 4; c++)
+    {
+        int e0 = (q0[c] << 1) | p0;
+        int e1 = (q1[c] << 1) | p1;
+        for (int i = 0; i < 16; i++)
+            palette[i][c] = ((64 - bc7_weights4[i]) * e0 + bc7_weights4[i] * e1 + 32) >> 6;
+    }
+}
+
+static void bc7_encode_mode6(const unsigned char rgba[64], unsigned char* block)
+{
+    int lo[4], hi[4];
+    bc_fit_endpoints(rgba, 4, lo, hi);
+
+    int q0[4], q1[4], p0, p1;
+    bc7_quantize_endpoint(lo, q0, &p0);
+    bc7_quantize_endpoint(hi, q1, &p1);
+
+    int palette[16][4];
+    bc7_palette(q0, p0, q1, p1, palette);
+
+    int indices[16];
+    for (int i = 0; i < 16; i++)
+    {
+        int best = 0, best_distance = bc_distance(palette[0], rgba + i * 4, 4);
+        for (int p = 1; p < 16; p++)
+        {
+            int distance = bc_distance(palette[p], rgba + i * 4, 4);
+            if (distance < best_distance)
+            {
+                best = p;
+                best_distance = distance;
+            }
+        }
+        indices[i] = best;
+    }
+
+    // anchor texel stores only 3 bits, its index must have the top bit clear
+    if (indices[0] & 8)
+    {
+        int tmp[4];
+        memcpy(tmp, q0, sizeof(tmp));
+        memcpy(q0, q1, sizeof(tmp));
+        memcpy(q1, tmp, sizeof(tmp));
+        int tmp_p = p0;
+        p0 = p1;
+        p1 = tmp_p;
+        for (int i = 0; i < 16; i++)
+            indices[i] = 15 - indices[i];
+    }
+
+    memset(block, 0, 16);
+    bc7_bits bits = { block, 0 };
+    bc7_write(&bits, 1 << 6, 7);
+    for (int c = 0; c < 4; c++)
+    {
+        bc7_write(&bits, q0[c], 7);
+        bc7_write(&bits, q1[c], 7);
+    }
+    bc7_write(&bits, p0, 1);
+    bc7_write(&bits, p1, 1);
+    bc7_write(&bits, indices[0], 3);
+    for (int i = 1; i < 16; i++)
+        bc7_write(&bits, indices[i], 4);
+}
+
+static void bc7_decode_mode6(const unsigned char* block, unsigned char rgba[64])
+{
+    bc7_bits bits = { (unsigned char*) block, 0 };
+
+    // other modes are never produced by the encoder
+    if (bc7_read(&bits, 7) != 1 << 6)
+    {
+        memset(rgba, 0, 64);
+        return;
+    }
+
+    int q0[4], q1[4];
+    for (int c = 0; c < 4; c++)
+    {
+        q0[c] = bc7_read(&bits, 7);
+        q1[c] = bc7_read(&bits, 7);
+    }
+    int p0 = bc7_read(&bits, 1);
+    int p1 = bc7_read(&bits, 1);
+
+    int palette[16][4];
+    bc7_palette(q0, p0, q1, p1, palette);
+
+    for (int i = 0; i < 16; i++)
+    {
+        int index = bc7_read(&bits, i == 0 ? 3 : 4);
+        for (int c = 0; c < 4; c++)
+            rgba[i * 4 + c] = palette[index][c];
+    }
+}
+#pragma endregion
+
+void bc_encode_block(bc_format format, const unsigned char rgba[64], unsigned char* block)
+{
+    switch (format)
+    {
+        case BC_FORMAT_BC1:
+            bc1_encode_color(rgba, block);
+            break;
+        case BC_FORMAT_BC3:
+            bc4_encode_alpha(rgba, block);
+            bc1_encode_color(rgba, block + 8);
+            break;
+        case BC_FORMAT_BC7:
+            bc7_encode_mode6(rgba, block);
+            break;
+    }
+}
+
+void bc_decode_block(bc_format format, const unsigned char* block, unsigned char rgba[64])
+{
+    switch (format)
+    {
+        case BC_FORMAT_BC1:
+            bc1_decode_color(block, false, rgba);
+            break;
+        case BC_FORMAT_BC3:
+            bc1_decode_color(block + 8, true, rgba);
+            bc4_decode_alpha(block, rgba);
+            break;
+        case BC_FORMAT_BC7:
+            bc7_decode_mode6(block, rgba);
+            break;
+    }
+}
+
+void bc_encode_image(bc_format format, const unsigned char* rgba, int width, int height, unsigned char* out)
+{
+    size_t block_size = bc_block_size(format);
+
+    for (int by = 0; by < height; by += 4)
+    {
+        for (int bx = 0; bx < width; bx += 4)
+        {
+            unsigned char texels[64];
+            for (int y = 0; y < 4; y++)
+            {
+                int sy = by + y < height ? by + y : height - 1;
+                for (int x = 0; x < 4; x++)
+                {
+                    int sx = bx + x < width ? bx + x : width - 1;
+                    memcpy(texels + (y * 4 + x) * 4, rgba + ((size_t) sy * width + sx) * 4, 4);
+                }
+            }
+
+            bc_encode_block(format, texels, out);
+            out += block_size;
+        }
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef __BC_H__
+#define __BC_H__
+
+#include <stddef.h>
+
+// block compressed formats, every format encodes 4x4 texel blocks
+typedef enum bc_format
+{
+    BC_FORMAT_BC1,  // RGB 5:6:5 endpoints, 8 bytes per block, alpha dropped
+    BC_FORMAT_BC3,  // BC1 color + interpolated 8-bit alpha, 16 bytes per block
+    BC_FORMAT_BC7   // mode 6 only: RGBA 7.1 endpoints with 16 index levels, 16 bytes per block
+} bc_format;
+
+size_t bc_block_size(bc_format format);
+
+/**
+ * bytes needed for a width x height image, edges are padded to whole blocks
+ */
+size_t bc_image_size(bc_format format, int width, int height);
+
+/**
+ * encodes one block from 16 RGBA texels in row-major order
+ */
+void bc_encode_block(bc_format format, const unsigned char rgba[64], unsigned char* block);
+
+/**
+ * decodes one block back to 16 RGBA texels, the CPU reference for the GPU decoder
+ */
+void bc_decode_block(bc_format format, const unsigned char* block, unsigned char rgba[64]);
+
+/**
+ * encodes a tightly packed RGBA image, partial edge blocks repeat the last row/column
+ */
+void bc_encode_image(bc_format format, const unsigned char* rgba, int width, int height, unsigned char* out);
+
+#endif // __BC_H__
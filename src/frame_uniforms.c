@@ -0,0 +1,50 @@
+#include "frame_uniforms.h"
+
+#include <stddef.h>
+
+#include "transform.h"
+
+#define ENABLE_LOGS
+#include "debug.h"
+
+_Static_assert(offsetof(frame_uniforms, time) == 192 && offsetof(frame_uniforms, viewport) == 200,
+               "frame_uniforms does not match std140 layout of the Frame block");
+
+static GLuint frame_ubo;
+
+void frame_uniforms_init(void)
+{
+    glGenBuffers(1, &frame_ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, frame_ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(frame_uniforms), NULL, GL_STREAM_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING, frame_ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    gl_check_error();
+}
+
+void frame_uniforms_shutdown(void)
+{
+    if (frame_ubo)
+        glDeleteBuffers(1, &frame_ubo);
+    frame_ubo = 0;
+}
+
+void frame_uniforms_update(frame_uniforms* frame)
+{
+    my_assert(frame_ubo, "frame uniforms are not initialized");
+
+    transform_mat4_mul(frame->projection, frame->view, frame->view_projection);
+
+    // respecified every frame, the driver hands out fresh storage instead of waiting for last frame's draws
+    glBindBuffer(GL_UNIFORM_BUFFER, frame_ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(frame_uniforms), frame, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    gl_check_error();
+}
+
+void frame_uniforms_attach(GLuint program)
+{
+    GLuint block = glGetUniformBlockIndex(program, FRAME_UNIFORMS_BLOCK);
+    if (block != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, block, FRAME_UNIFORMS_BINDING);
+}
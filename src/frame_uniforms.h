@@ -0,0 +1,42 @@
+#ifndef __FRAME_UNIFORMS_H__
+#define __FRAME_UNIFORMS_H__
+
+#include <glad/glad.h>
+
+// uniform block shared by all programs, declared in shaders/frame.glsl
+#define FRAME_UNIFORMS_BLOCK   "Frame"
+#define FRAME_UNIFORMS_BINDING 0
+
+/**
+ * per frame values, matches the std140 layout of the Frame block
+ * matrices are column major like cglm's mat4
+ */
+typedef struct frame_uniforms
+{
+    float view[16];
+    float projection[16];
+    float view_projection[16];  // filled by frame_uniforms_update()
+    float time;                 // seconds since start
+    float delta_time;
+    float viewport[2];
+} frame_uniforms;
+
+/**
+ * creates uniform buffer and binds it to FRAME_UNIFORMS_BINDING
+ * programs are attached to it when reflected at link time (see shader_reflect())
+ */
+void frame_uniforms_init(void);
+
+void frame_uniforms_shutdown(void);
+
+/**
+ * computes view_projection and uploads the whole block, once per frame for all programs
+ */
+void frame_uniforms_update(frame_uniforms* frame);
+
+/**
+ * points program's Frame block at FRAME_UNIFORMS_BINDING, does nothing when it does not declare one
+ */
+void frame_uniforms_attach(GLuint program);
+
+#endif // __FRAME_UNIFORMS_H__
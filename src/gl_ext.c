@@ -0,0 +1,89 @@
+#include "gl_ext.h"
+
+#include <string.h>
+
+#define ENABLE_LOGS
+#include "debug.h"
+
+gl_ext_support gl_ext;
+
+bool gl_ext_has(const char* name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+
+    for (GLint i = 0; i < count; i++)
+    {
+        const char* extension = (const char*) glGetStringi(GL_EXTENSIONS, i);
+        if (extension && strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+static bool gl_ext_version_at_least(int major, int minor)
+{
+    return gl_ext.version_major > major || (gl_ext.version_major == major && gl_ext.version_minor >= minor);
+}
+
+void gl_ext_init(GLADloadproc load)
+{
+    glGetIntegerv(GL_MAJOR_VERSION, &gl_ext.version_major);
+    glGetIntegerv(GL_MINOR_VERSION, &gl_ext.version_minor);
+
+    gl_ext.texture_compression_s3tc = gl_ext_has("GL_EXT_texture_compression_s3tc");
+    gl_ext.texture_compression_bptc = gl_ext_version_at_least(4, 2) || gl_ext_has("GL_ARB_texture_compression_bptc");
+
+    if (gl_ext_version_at_least(4, 2) || gl_ext_has("GL_ARB_texture_storage"))
+    {
+        gl_ext.tex_storage_2d = (gl_tex_storage_2d_proc) load("glTexStorage2D");
+        gl_ext.tex_storage_3d = (gl_tex_storage_3d_proc) load("glTexStorage3D");
+    }
+
+    // drivers may expose the entry points without a single format to save in
+    GLint binary_formats = 0;
+    if (gl_ext_version_at_least(4, 1) || gl_ext_has("GL_ARB_get_program_binary"))
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binary_formats);
+    if (binary_formats > 0)
+    {
+        gl_ext.get_program_binary = (gl_get_program_binary_proc) load("glGetProgramBinary");
+        gl_ext.program_binary = (gl_program_binary_proc) load("glProgramBinary");
+        gl_ext.program_parameteri = (gl_program_parameteri_proc) load("glProgramParameteri");
+    }
+
+    // the driver picks the compiler thread count, 0xFFFFFFFF means as many as it likes
+    gl_max_shader_compiler_threads_proc max_shader_compiler_threads = NULL;
+    if (gl_ext_has("GL_KHR_parallel_shader_compile"))
+        max_shader_compiler_threads = (gl_max_shader_compiler_threads_proc) load("glMaxShaderCompilerThreadsKHR");
+    else if (gl_ext_has("GL_ARB_parallel_shader_compile"))
+        max_shader_compiler_threads = (gl_max_shader_compiler_threads_proc) load("glMaxShaderCompilerThreadsARB");
+    if (max_shader_compiler_threads)
+    {
+        max_shader_compiler_threads(0xFFFFFFFFu);
+        gl_ext.parallel_shader_compile = true;
+    }
+
+    if (gl_ext_version_at_least(4, 3) || gl_ext_has("GL_ARB_program_interface_query"))
+        gl_ext.get_program_resourceiv = (gl_get_program_resourceiv_proc) load("glGetProgramResourceiv");
+
+    if (gl_ext_version_at_least(4, 6))
+    {
+        gl_ext.shader_binary = (gl_shader_binary_proc) load("glShaderBinary");
+        gl_ext.specialize_shader = (gl_specialize_shader_proc) load("glSpecializeShader");
+    }
+    else if (gl_ext_has("GL_ARB_gl_spirv"))
+    {
+        gl_ext.shader_binary = (gl_shader_binary_proc) load("glShaderBinary");
+        gl_ext.specialize_shader = (gl_specialize_shader_proc) load("glSpecializeShaderARB");
+    }
+    if (gl_ext.shader_binary == NULL || gl_ext.specialize_shader == NULL)
+    {
+        gl_ext.shader_binary = NULL;
+        gl_ext.specialize_shader = NULL;
+    }
+    gl_check_error();
+
+    my_log(INFOMSG("OpenGL %d.%d, s3tc: %d, bptc: %d, texture storage: %d, program binary: %d, parallel compile: %d, spir-v: %d\n"), gl_ext.version_major, gl_ext.version_minor,
+           gl_ext.texture_compression_s3tc, gl_ext.texture_compression_bptc, gl_ext.tex_storage_2d != NULL, gl_ext.get_program_binary != NULL,
+           gl_ext.parallel_shader_compile, gl_ext.specialize_shader != NULL);
+}
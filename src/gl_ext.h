@@ -0,0 +1,69 @@
+#ifndef __GL_EXT_H__
+#define __GL_EXT_H__
+
+#include <glad/glad.h>
+#include <stdbool.h>
+
+// entry points newer than the 4.0 core GLAD was generated for
+typedef void (APIENTRYP gl_tex_storage_2d_proc)(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height);
+typedef void (APIENTRYP gl_tex_storage_3d_proc)(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth);
+typedef void (APIENTRYP gl_get_program_binary_proc)(GLuint program, GLsizei buffer_size, GLsizei* length, GLenum* binary_format, void* binary);
+typedef void (APIENTRYP gl_program_binary_proc)(GLuint program, GLenum binary_format, const void* binary, GLsizei length);
+typedef void (APIENTRYP gl_program_parameteri_proc)(GLuint program, GLenum pname, GLint value);
+typedef void (APIENTRYP gl_max_shader_compiler_threads_proc)(GLuint count);
+typedef void (APIENTRYP gl_shader_binary_proc)(GLsizei count, const GLuint* shaders, GLenum binary_format, const void* binary, GLsizei length);
+typedef void (APIENTRYP gl_specialize_shader_proc)(GLuint shader, const GLchar* entry_point, GLuint constant_count, const GLuint* constant_index, const GLuint* constant_value);
+typedef void (APIENTRYP gl_get_program_resourceiv_proc)(GLuint program, GLenum interface, GLuint index, GLsizei prop_count, const GLenum* props, GLsizei count, GLsizei* length, GLint* params);
+
+// 4.3 / ARB_program_interface_query
+#ifndef GL_UNIFORM
+#define GL_UNIFORM 0x92E1
+#endif
+#ifndef GL_LOCATION
+#define GL_LOCATION 0x930E
+#endif
+
+// 4.6 / ARB_gl_spirv
+#ifndef GL_SHADER_BINARY_FORMAT_SPIR_V
+#define GL_SHADER_BINARY_FORMAT_SPIR_V 0x9551
+#endif
+
+// optional features of the current context, filled by gl_ext_init()
+typedef struct gl_ext_support
+{
+    int version_major;
+    int version_minor;
+    bool texture_compression_s3tc;  // BC1-BC3
+    bool texture_compression_bptc;  // BC6H/BC7, core since 4.2
+
+    // immutable texture storage (4.2 or ARB_texture_storage), NULL when missing
+    gl_tex_storage_2d_proc tex_storage_2d;
+    gl_tex_storage_3d_proc tex_storage_3d;
+
+    // program binaries (4.1 or ARB_get_program_binary) with at least one binary format, NULL otherwise
+    gl_get_program_binary_proc get_program_binary;
+    gl_program_binary_proc program_binary;
+    gl_program_parameteri_proc program_parameteri;
+
+    // KHR_parallel_shader_compile (or the ARB variant): GL_COMPLETION_STATUS_KHR can be polled without blocking
+    bool parallel_shader_compile;
+
+    // SPIR-V shader modules (4.6 or ARB_gl_spirv), NULL when missing
+    gl_shader_binary_proc shader_binary;
+    gl_specialize_shader_proc specialize_shader;
+
+    // program interface queries (4.3 or ARB_program_interface_query), NULL when missing
+    gl_get_program_resourceiv_proc get_program_resourceiv;
+} gl_ext_support;
+
+extern gl_ext_support gl_ext;
+
+/**
+ * queries version and extensions of the current context and loads optional entry points
+ * call right after GLAD is loaded, with the same loader
+ */
+void gl_ext_init(GLADloadproc load);
+
+bool gl_ext_has(const char* name);
+
+#endif // __GL_EXT_H__
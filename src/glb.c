@@ -0,0 +1,576 @@
+#include "glb.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define ENABLE_LOGS
+#include "debug.h"
+
+#define GLB_MAGIC       0x46546c67u  // "glTF"
+#define GLB_VERSION     2
+#define GLB_HEADER_SIZE 12
+#define GLB_CHUNK_JSON  0x4e4f534au
+#define GLB_CHUNK_BIN   0x004e4942u
+
+#define GLB_MODE_TRIANGLES 4
+
+// glTF nests a handful of levels deep, anything past this is not a model
+#define JSON_MAX_DEPTH 64
+
+#pragma region json
+typedef enum json_type
+{
+    JSON_OBJECT,
+    JSON_ARRAY,
+    JSON_STRING,
+    JSON_PRIMITIVE  // number, true, false or null
+} json_type;
+
+// flat token list, children follow their parent, next skips the whole subtree
+typedef struct json_token
+{
+    json_type type;
+    int start;  // strings without their quotes
+    int end;
+    int size;   // members of an object, elements of an array
+    int next;
+} json_token;
+
+typedef struct json_document
+{
+    const char* text;
+    int length;
+    int pos;
+    json_token* tokens;
+    int count;
+    int capacity;
+} json_document;
+
+static int json_push(json_document* doc, json_type type, int start)
+{
+    if (doc->count == doc->capacity)
+    {
+        doc->capacity = doc->capacity ? doc->capacity * 2 : 256;
+        doc->tokens = realloc(doc->tokens, sizeof(json_token) * doc->capacity);
+        my_assert(doc->tokens, "failed to grow json tokens");
+    }
+    doc->tokens[doc->count] = (json_token) { .type = type, .start = start, .end = start };
+    return doc->count++;
+}
+
+static inline bool json_is_whitespace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static void json_skip_whitespace(json_document* doc)
+{
+    while (doc->pos < doc->length && json_is_whitespace(doc->text[doc->pos]))
+        doc->pos++;
+}
+
+/**
+ * returns index of the value's token, -1 on a syntax error
+ */
+static int json_parse_value(json_document* doc, int depth)
+{
+    json_skip_whitespace(doc);
+    if (doc->pos >= doc->length || depth > JSON_MAX_DEPTH)
+        return -1;
+
+    int token;
+    char c = doc->text[doc->pos];
+    if (c == '{' || c == '[')
+    {
+        bool object = c == '{';
+        char close = object ? '}' : ']';
+        token = json_push(doc, object ? JSON_OBJECT : JSON_ARRAY, doc->pos++);
+
+        json_skip_whitespace(doc);
+        if (doc->pos < doc->length && doc->text[doc->pos] == close)
+            doc->pos++;
+        else
+        {
+            for (;;)
+            {
+                if (object)
+                {
+                    json_skip_whitespace(doc);
+                    if (doc->pos >= doc->length || doc->text[doc->pos] != '"' || json_parse_value(doc, depth + 1) < 0)
+                        return -1;
+                    json_skip_whitespace(doc);
+                    if (doc->pos >= doc->length || doc->text[doc->pos++] != ':')
+                        return -1;
+                }
+                if (json_parse_value(doc, depth + 1) < 0)
+                    return -1;
+                doc->tokens[token].size++;
+
+                json_skip_whitespace(doc);
+                if (doc->pos >= doc->length)
+                    return -1;
+                char separator = doc->text[doc->pos++];
+                if (separator == close)
+                    break;
+                if (separator != ',')
+                    return -1;
+            }
+        }
+    }
+    else if (c == '"')
+    {
+        token = json_push(doc, JSON_STRING, ++doc->pos);
+        while (doc->pos < doc->length && doc->text[doc->pos] != '"')
+            doc->pos += doc->text[doc->pos] == '\\' ? 2 : 1;
+        if (doc->pos >= doc->length)
+            return -1;
+        doc->tokens[token].end = doc->pos++;
+        doc->tokens[token].next = doc->count;
+        return token;
+    }
+    else
+    {
+        token = json_push(doc, JSON_PRIMITIVE, doc->pos);
+        while (doc->pos < doc->length && !json_is_whitespace(doc->text[doc->pos]) && !strchr(",]}", doc->text[doc->pos]))
+            doc->pos++;
+        if (doc->pos == doc->tokens[token].start)
+            return -1;
+    }
+
+    doc->tokens[token].end = doc->pos;
+    doc->tokens[token].next = doc->count;
+    return token;
+}
+
+/**
+ * value of key in object, -1 when missing or object is not an object
+ */
+static int json_find(const json_document* doc, int object, const char* key)
+{
+    if (object < 0 || doc->tokens[object].type != JSON_OBJECT)
+        return -1;
+
+    size_t key_length = strlen(key);
+    int t = object + 1;
+    for (int i = 0; i < doc->tokens[object].size; i++, t = doc->tokens[t + 1].next)
+    {
+        const json_token* name = &doc->tokens[t];
+        if ((size_t) (name->end - name->start) == key_length && memcmp(doc->text + name->start, key, key_length) == 0)
+            return t + 1;
+    }
+    return -1;
+}
+
+static int json_array_size(const json_document* doc, int array)
+{
+    return array >= 0 && doc->tokens[array].type == JSON_ARRAY ? doc->tokens[array].size : 0;
+}
+
+static int json_at(const json_document* doc, int array, long long index)
+{
+    if (index < 0 || index >= json_array_size(doc, array))
+        return -1;
+
+    int t = array + 1;
+    for (long long i = 0; i < index; i++)
+        t = doc->tokens[t].next;
+    return t;
+}
+
+/**
+ * non-negative integer, fallback when missing and -1 when it is something else
+ */
+static long long json_uint(const json_document* doc, int token, long long fallback)
+{
+    if (token < 0)
+        return fallback;
+    const json_token* t = &doc->tokens[token];
+    if (t->type != JSON_PRIMITIVE || t->end - t->start > 15)
+        return -1;
+
+    long long value = 0;
+    for (int i = t->start; i < t->end; i++)
+    {
+        if (doc->text[i] < '0' || doc->text[i] > '9')
+            return -1;
+        value = value * 10 + (doc->text[i] - '0');
+    }
+    return value;
+}
+
+static bool json_is(const json_document* doc, int token, const char* text)
+{
+    size_t length = strlen(text);
+    return token >= 0 && (size_t) (doc->tokens[token].end - doc->tokens[token].start) == length
+        && memcmp(doc->text + doc->tokens[token].start, text, length) == 0;
+}
+#pragma endregion
+
+typedef struct glb_accessor
+{
+    int view;
+    GLenum component_type;  // glTF uses the GL enums
+    GLint components;
+    GLboolean normalized;
+    GLsizei stride;         // 0 when tightly packed
+    size_t offset;          // from the start of the bufferView
+    GLsizei count;
+} glb_accessor;
+
+typedef struct glb_file
+{
+    json_document json;
+    const unsigned char* bin;
+    size_t bin_length;
+    int views;
+    int accessors;
+    const char* error;
+} glb_file;
+
+static const struct
+{
+    const char* name;
+    GLuint location;
+} glb_attributes[] = {
+    { "POSITION",   GLB_LOCATION_POSITION },
+    { "COLOR_0",    GLB_LOCATION_COLOR },
+    { "TEXCOORD_0", GLB_LOCATION_TEXCOORD },
+    { "NORMAL",     GLB_LOCATION_NORMAL }
+};
+
+static inline uint32_t glb_read_u32(const unsigned char* p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static size_t glb_component_size(GLenum type)
+{
+    switch (type)
+    {
+        case GL_BYTE:
+        case GL_UNSIGNED_BYTE:
+            return 1;
+        case GL_SHORT:
+        case GL_UNSIGNED_SHORT:
+            return 2;
+        case GL_UNSIGNED_INT:
+        case GL_FLOAT:
+            return 4;
+        default:
+            return 0;
+    }
+}
+
+static GLint glb_component_count(const json_document* doc, int type)
+{
+    static const char* types[] = { "SCALAR", "VEC2", "VEC3", "VEC4" };
+    for (int i = 0; i < 4; i++)
+        if (json_is(doc, type, types[i]))
+            return i + 1;
+    return 0;
+}
+
+static bool glb_fail(glb_file* file, const char* error)
+{
+    file->error = error;
+    return false;
+}
+
+/**
+ * bufferView range inside the BIN chunk, only the buffer embedded in the .glb can be referenced
+ */
+static bool glb_view_range(glb_file* file, int view, size_t* offset, size_t* length, GLsizei* stride)
+{
+    const json_document* doc = &file->json;
+    int token = json_at(doc, file->views, view);
+    if (token < 0)
+        return glb_fail(file, "bufferView out of range");
+
+    long long buffer = json_uint(doc, json_find(doc, token, "buffer"), -1);
+    long long view_offset = json_uint(doc, json_find(doc, token, "byteOffset"), 0);
+    long long view_length = json_uint(doc, json_find(doc, token, "byteLength"), -1);
+    long long view_stride = json_uint(doc, json_find(doc, token, "byteStride"), 0);
+
+    if (buffer != 0 || file->bin == NULL)
+        return glb_fail(file, "external buffers are not supported");
+    if (view_offset < 0 || view_length < 0 || view_stride < 0 || view_stride > 252
+        || (size_t) view_offset > file->bin_length || (size_t) view_length > file->bin_length - view_offset)
+        return glb_fail(file, "bufferView outside of the BIN chunk");
+
+    *offset = view_offset;
+    *length = view_length;
+    *stride = (GLsizei) view_stride;
+    return true;
+}
+
+static bool glb_accessor_resolve(glb_file* file, long long index, glb_accessor* accessor)
+{
+    const json_document* doc = &file->json;
+    int token = json_at(doc, file->accessors, index);
+    if (token < 0)
+        return glb_fail(file, "accessor out of range");
+    if (json_find(doc, token, "sparse") >= 0)
+        return glb_fail(file, "sparse accessors are not supported");
+
+    long long view = json_uint(doc, json_find(doc, token, "bufferView"), -1);
+    long long offset = json_uint(doc, json_find(doc, token, "byteOffset"), 0);
+    long long count = json_uint(doc, json_find(doc, token, "count"), -1);
+    GLenum component_type = (GLenum) json_uint(doc, json_find(doc, token, "componentType"), 0);
+    GLint components = glb_component_count(doc, json_find(doc, token, "type"));
+    size_t component_size = glb_component_size(component_type);
+
+    if (view < 0)
+        return glb_fail(file, "accessor without bufferView");
+    if (offset < 0 || count <= 0 || count > INT32_MAX || component_size == 0 || components == 0)
+        return glb_fail(file, "unsupported accessor");
+
+    size_t view_offset, view_length;
+    GLsizei stride;
+    if (!glb_view_range(file, (int) view, &view_offset, &view_length, &stride))
+        return false;
+
+    size_t element = component_size * components;
+    size_t step = stride ? (size_t) stride : element;
+    if ((size_t) offset > view_length || (size_t) (count - 1) * step + element > view_length - offset)
+        return glb_fail(file, "accessor outside of its bufferView");
+
+    *accessor = (glb_accessor) {
+        .view = (int) view,
+        .component_type = component_type,
+        .components = components,
+        .normalized = json_is(doc, json_find(doc, token, "normalized"), "true"),
+        .stride = stride,
+        .offset = offset,
+        .count = (GLsizei) count
+    };
+    return true;
+}
+
+/**
+ * buffer of a bufferView, uploaded from the mapping the first time a primitive uses it
+ */
+static GLuint glb_view_buffer(glb_model* model, glb_file* file, int view, GLenum target)
+{
+    if (model->buffers[view] == 0)
+    {
+        size_t offset, length;
+        GLsizei stride;
+        glb_view_range(file, view, &offset, &length, &stride);
+
+        glGenBuffers(1, &model->buffers[view]);
+        glBindBuffer(target, model->buffers[view]);
+        glBufferData(target, length, file->bin + offset, GL_STATIC_DRAW);
+    }
+    glBindBuffer(target, model->buffers[view]);
+    return model->buffers[view];
+}
+
+static bool glb_primitive_create(glb_model* model, glb_file* file, int token, glb_primitive* primitive)
+{
+    const json_document* doc = &file->json;
+    int attributes = json_find(doc, token, "attributes");
+    long long mode = json_uint(doc, json_find(doc, token, "mode"), GLB_MODE_TRIANGLES);
+    if (mode < 0 || mode > GL_TRIANGLE_FAN)
+        return glb_fail(file, "unsupported primitive mode");
+
+    glGenVertexArrays(1, &primitive->vao);
+    glBindVertexArray(primitive->vao);
+    primitive->mode = (GLenum) mode;
+
+    for (size_t i = 0; i < sizeof(glb_attributes) / sizeof(glb_attributes[0]); i++)
+    {
+        long long index = json_uint(doc, json_find(doc, attributes, glb_attributes[i].name), -1);
+        if (index < 0)
+            continue;
+
+        glb_accessor accessor;
+        if (!glb_accessor_resolve(file, index, &accessor))
+            return false;
+
+        glb_view_buffer(model, file, accessor.view, GL_ARRAY_BUFFER);
+        glVertexAttribPointer(glb_attributes[i].location, accessor.components, accessor.component_type,
+                              accessor.normalized, accessor.stride, (void*) accessor.offset);
+        glEnableVertexAttribArray(glb_attributes[i].location);
+
+        if (glb_attributes[i].location == GLB_LOCATION_POSITION)
+            primitive->count = accessor.count;
+        primitive->has_color |= glb_attributes[i].location == GLB_LOCATION_COLOR;
+    }
+    if (primitive->count == 0)
+        return glb_fail(file, "primitive without POSITION");
+
+    long long indices = json_uint(doc, json_find(doc, token, "indices"), -1);
+    if (indices >= 0)
+    {
+        glb_accessor accessor;
+        if (!glb_accessor_resolve(file, indices, &accessor))
+            return false;
+        if (accessor.components != 1 || accessor.component_type == GL_BYTE || accessor.component_type == GL_SHORT
+            || accessor.component_type == GL_FLOAT)
+            return glb_fail(file, "unsupported index accessor");
+
+        // element buffer binding is part of the VAO
+        glb_view_buffer(model, file, accessor.view, GL_ELEMENT_ARRAY_BUFFER);
+        primitive->count = accessor.count;
+        primitive->index_type = accessor.component_type;
+        primitive->index_offset = accessor.offset;
+    }
+    return true;
+}
+
+static bool glb_model_create(glb_model* model, glb_file* file)
+{
+    const json_document* doc = &file->json;
+    file->views = json_find(doc, 0, "bufferViews");
+    file->accessors = json_find(doc, 0, "accessors");
+    int meshes = json_find(doc, 0, "meshes");
+
+    // the BIN chunk is buffer 0, it must not point anywhere else
+    int buffer = json_at(doc, json_find(doc, 0, "buffers"), 0);
+    if (buffer >= 0 && json_find(doc, buffer, "uri") >= 0)
+        file->bin = NULL;
+
+    model->buffer_count = json_array_size(doc, file->views);
+    model->buffers = calloc(model->buffer_count + 1, sizeof(GLuint));
+    my_assert(model->buffers, "failed to allocate glb buffers");
+
+    int primitive_count = 0;
+    for (int mesh = 0; mesh < json_array_size(doc, meshes); mesh++)
+        primitive_count += json_array_size(doc, json_find(doc, json_at(doc, meshes, mesh), "primitives"));
+    if (primitive_count == 0)
+        return glb_fail(file, "no mesh primitives");
+
+    model->primitives = calloc(primitive_count, sizeof(glb_primitive));
+    my_assert(model->primitives, "failed to allocate glb primitives");
+
+    for (int mesh = 0; mesh < json_array_size(doc, meshes); mesh++)
+    {
+        int primitives = json_find(doc, json_at(doc, meshes, mesh), "primitives");
+        for (int i = 0; i < json_array_size(doc, primitives); i++)
+        {
+            glb_primitive* primitive = &model->primitives[model->primitive_count++];
+            if (!glb_primitive_create(model, file, json_at(doc, primitives, i), primitive))
+                return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * checks header and chunk layout, the JSON chunk is mandatory, the BIN chunk optional
+ */
+static bool glb_parse(glb_file* file, const unsigned char* base, size_t size)
+{
+    if (size < GLB_HEADER_SIZE + 8 || glb_read_u32(base) != GLB_MAGIC || glb_read_u32(base + 4) != GLB_VERSION)
+        return glb_fail(file, "not a glTF 2.0 binary");
+
+    // chunk ends are sums of 32-bit fields, they cannot wrap in size_t, differences of them can
+    size_t length = glb_read_u32(base + 8);
+    if (length < GLB_HEADER_SIZE + 8 || length > size)
+        return glb_fail(file, "corrupted chunks");
+
+    size_t json_length = glb_read_u32(base + GLB_HEADER_SIZE);
+    size_t bin_chunk = GLB_HEADER_SIZE + 8 + json_length;
+    if (glb_read_u32(base + GLB_HEADER_SIZE + 4) != GLB_CHUNK_JSON || bin_chunk > length || bin_chunk > size)
+        return glb_fail(file, "corrupted chunks");
+
+    if (bin_chunk + 8 <= length && glb_read_u32(base + bin_chunk + 4) == GLB_CHUNK_BIN)
+    {
+        file->bin = base + bin_chunk + 8;
+        file->bin_length = glb_read_u32(base + bin_chunk);
+        size_t bin_end = bin_chunk + 8 + file->bin_length;
+        if (bin_end > length || bin_end > size)
+            return glb_fail(file, "corrupted chunks");
+    }
+
+    file->json.text = (const char*) base + GLB_HEADER_SIZE + 8;
+    file->json.length = (int) json_length;
+    if (json_parse_value(&file->json, 0) != 0 || file->json.tokens[0].type != JSON_OBJECT)
+        return glb_fail(file, "malformed JSON chunk");
+    return true;
+}
+
+bool glb_load(const char* path, glb_model* model)
+{
+    memset(model, 0, sizeof(glb_model));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        my_log(ERRMSG("failed to open glb: ") PATHMSG("%s\n"), path);
+        return false;
+    }
+
+    struct stat st;
+    size_t size = fstat(fd, &st) == 0 ? (size_t) st.st_size : 0;
+    const unsigned char* base = size ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        my_log(ERRMSG("failed to map glb: ") PATHMSG("%s\n"), path);
+        return false;
+    }
+
+    // loading can happen in the middle of the caller's VAO setup, creating the primitive VAOs must not break it
+    GLint previous_vao, previous_buffer;
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previous_vao);
+    glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &previous_buffer);
+
+    glb_file file = { 0 };
+    bool ok = glb_parse(&file, base, size) && glb_model_create(model, &file);
+
+    glBindVertexArray((GLuint) previous_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, (GLuint) previous_buffer);
+    gl_check_error();
+    free(file.json.tokens);
+    munmap((void*) base, size);
+
+    if (!ok)
+    {
+        my_log(ERRMSG("invalid glb: ") PATHMSG("%s") " (%s)\n", path, file.error);
+        glb_free(model);
+        return false;
+    }
+
+    my_log(INFOMSG("glb: %d primitives, %d buffers: ") PATHMSG("%s\n"), model->primitive_count, model->buffer_count, path);
+    return true;
+}
+
+void glb_draw(const glb_model* model)
+{
+    for (int i = 0; i < model->primitive_count; i++)
+    {
+        const glb_primitive* primitive = &model->primitives[i];
+        glBindVertexArray(primitive->vao);
+
+        // current attribute value is context state, not part of the VAO
+        if (!primitive->has_color)
+            glVertexAttrib3f(GLB_LOCATION_COLOR, 1.0f, 1.0f, 1.0f);
+
+        if (primitive->index_type)
+            glDrawElements(primitive->mode, primitive->count, primitive->index_type, (void*) primitive->index_offset);
+        else
+            glDrawArrays(primitive->mode, 0, primitive->count);
+    }
+    glBindVertexArray(0);
+}
+
+void glb_free(glb_model* model)
+{
+    for (int i = 0; i < model->primitive_count; i++)
+        if (model->primitives[i].vao)
+            glDeleteVertexArrays(1, &model->primitives[i].vao);
+    if (model->buffers)
+        glDeleteBuffers(model->buffer_count, model->buffers);
+
+    free(model->primitives);
+    free(model->buffers);
+    memset(model, 0, sizeof(glb_model));
+}
@@ -0,0 +1,52 @@
+#ifndef __GLB_H__
+#define __GLB_H__
+
+#include <glad/glad.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "vertex_format.h"
+
+// vertex attribute locations glTF attributes are bound to
+#define GLB_LOCATION_POSITION VERTEX_LOCATION_POSITION
+#define GLB_LOCATION_COLOR    VERTEX_LOCATION_COLOR
+#define GLB_LOCATION_TEXCOORD VERTEX_LOCATION_TEXCOORD
+#define GLB_LOCATION_NORMAL   VERTEX_LOCATION_NORMAL
+
+typedef struct glb_primitive
+{
+    GLuint vao;
+    GLenum mode;
+    GLsizei count;        // indices, or vertices when not indexed
+    GLenum index_type;    // 0 when not indexed
+    size_t index_offset;
+    bool has_color;       // without COLOR_0 the color attribute is white
+} glb_primitive;
+
+/**
+ * every primitive of every mesh in the file, node transforms are not applied
+ */
+typedef struct glb_model
+{
+    GLuint* buffers;      // one per bufferView, 0 for views no primitive uses (images, animations)
+    int buffer_count;
+    glb_primitive* primitives;
+    int primitive_count;
+} glb_model;
+
+/**
+ * maps a glTF 2.0 binary file and uploads the bufferViews its primitives use straight from the BIN chunk,
+ * attribute formats and strides come from the accessors, nothing is converted on the CPU
+ * sparse accessors and external buffers are not supported
+ * returns false and logs why when the file is missing or not a valid .glb
+ */
+bool glb_load(const char* path, glb_model* model);
+
+/**
+ * draws all primitives with the program in use
+ */
+void glb_draw(const glb_model* model);
+
+void glb_free(glb_model* model);
+
+#endif // __GLB_H__
@@ -0,0 +1,358 @@
+#include "ktx2.h"
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define ENABLE_LOGS
+#include "debug.h"
+
+static const unsigned char ktx2_identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+#define KTX2_HEADER_SIZE      80 // identifier + header + index
+#define KTX2_LEVEL_INDEX_SIZE 24
+#define KTX2_ORIENTATION_KEY  "KTXorientation"
+// our own key, 16 hex digits of the source hash
+#define KTX2_SOURCE_HASH_KEY  "huhSourceHash"
+
+// Khronos data format descriptor values used for BC formats
+#define KHR_DF_MODEL_BC1A        128
+#define KHR_DF_MODEL_BC3         130
+#define KHR_DF_MODEL_BC7         134
+#define KHR_DF_PRIMARIES_BT709   1
+#define KHR_DF_TRANSFER_LINEAR   1
+#define KHR_DF_TRANSFER_SRGB     2
+#define KHR_DF_CHANNEL_COLOR     0
+#define KHR_DF_CHANNEL_BC3_ALPHA 15
+
+static uint32_t ktx2_read_u32(const unsigned char* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static uint64_t ktx2_read_u64(const unsigned char* p)
+{
+    return ktx2_read_u32(p) | ((uint64_t) ktx2_read_u32(p + 4) << 32);
+}
+
+static unsigned char* ktx2_put_u32(unsigned char* p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+        p[i] = (v >> (i * 8)) & 0xff;
+    return p + 4;
+}
+
+static unsigned char* ktx2_put_u64(unsigned char* p, uint64_t v)
+{
+    p = ktx2_put_u32(p, (uint32_t) v);
+    return ktx2_put_u32(p, (uint32_t) (v >> 32));
+}
+
+static size_t ktx2_block_size(uint32_t vk_format)
+{
+    switch (vk_format)
+    {
+        case KTX2_VK_FORMAT_BC1_RGB_UNORM:
+        case KTX2_VK_FORMAT_BC1_RGB_SRGB:
+            return 8;
+        case KTX2_VK_FORMAT_BC3_UNORM:
+        case KTX2_VK_FORMAT_BC3_SRGB:
+        case KTX2_VK_FORMAT_BC7_UNORM:
+        case KTX2_VK_FORMAT_BC7_SRGB:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+static bool ktx2_is_srgb(uint32_t vk_format)
+{
+    return vk_format == KTX2_VK_FORMAT_BC1_RGB_SRGB || vk_format == KTX2_VK_FORMAT_BC3_SRGB || vk_format == KTX2_VK_FORMAT_BC7_SRGB;
+}
+
+void ktx2_path(const char* source_path, char* out, size_t out_size)
+{
+    // the source extension stays, wall.jpg and wall.png must not share a compressed file
+    snprintf(out, out_size, "%s" KTX2_EXTENSION, source_path);
+}
+
+/**
+ * value of key in key/value data, NULL when missing, value_length counts its terminating zero
+ */
+static const char* ktx2_find_value(const unsigned char* kvd, size_t length, const char* key, size_t* value_length)
+{
+    size_t position = 0;
+    while (position + 4 <= length)
+    {
+        uint32_t pair_length = ktx2_read_u32(kvd + position);
+        const char* pair = (const char*) kvd + position + 4;
+        if (pair_length > length - position - 4)
+            break;
+
+        size_t key_length = strnlen(pair, pair_length);
+        if (key_length < pair_length && strcmp(pair, key) == 0)
+        {
+            *value_length = pair_length - key_length - 1;
+            return pair + key_length + 1;
+        }
+
+        position += 4 + ((pair_length + 3) & ~3u);
+    }
+    return NULL;
+}
+
+/**
+ * KTXorientation "r?", missing key means the default top-down rows
+ */
+static bool ktx2_parse_bottom_up(const unsigned char* kvd, size_t length)
+{
+    size_t value_length;
+    const char* value = ktx2_find_value(kvd, length, KTX2_ORIENTATION_KEY, &value_length);
+    return value && value_length > 1 && value[1] == 'u';
+}
+
+static uint64_t ktx2_parse_source_hash(const unsigned char* kvd, size_t length)
+{
+    size_t value_length;
+    const char* value = ktx2_find_value(kvd, length, KTX2_SOURCE_HASH_KEY, &value_length);
+    if (value == NULL || value_length != 17 || value[16] != '\0')
+        return 0;
+    return strtoull(value, NULL, 16);
+}
+
+bool ktx2_map(const char* path, ktx2_file* file)
+{
+    memset(file, 0, sizeof(ktx2_file));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < KTX2_HEADER_SIZE)
+    {
+        close(fd);
+        return false;
+    }
+
+    size_t size = st.st_size;
+    unsigned char* base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return false;
+
+    const unsigned char* header = base + sizeof(ktx2_identifier);
+    uint32_t vk_format = ktx2_read_u32(header);
+    uint32_t width = ktx2_read_u32(header + 8);
+    uint32_t height = ktx2_read_u32(header + 12);
+    uint32_t depth = ktx2_read_u32(header + 16);
+    uint32_t layers = ktx2_read_u32(header + 20);
+    uint32_t faces = ktx2_read_u32(header + 24);
+    uint32_t levels = ktx2_read_u32(header + 28);
+    uint32_t supercompression = ktx2_read_u32(header + 32);
+    uint32_t kvd_offset = ktx2_read_u32(header + 44);
+    uint32_t kvd_length = ktx2_read_u32(header + 48);
+
+    // level count 0 asks the loader to generate mips, we upload just the base level then
+    if (levels == 0)
+        levels = 1;
+
+    size_t block_size = ktx2_block_size(vk_format);
+    bool valid = memcmp(base, ktx2_identifier, sizeof(ktx2_identifier)) == 0
+              && block_size != 0
+              && width > 0 && height > 0 && depth == 0 && layers == 0 && faces == 1
+              && supercompression == 0
+              && levels <= MIPMAP_MAX_LEVELS
+              && KTX2_HEADER_SIZE + levels * KTX2_LEVEL_INDEX_SIZE <= size
+              && kvd_offset <= size && kvd_length <= size - kvd_offset;
+
+    mip_chain* chain = &file->chain;
+    for (uint32_t i = 0; i < levels && valid; i++)
+    {
+        const unsigned char* entry = base + KTX2_HEADER_SIZE + i * KTX2_LEVEL_INDEX_SIZE;
+        uint64_t offset = ktx2_read_u64(entry);
+        uint64_t length = ktx2_read_u64(entry + 8);
+
+        int level_width = width >> i ? width >> i : 1;
+        int level_height = height >> i ? height >> i : 1;
+        size_t expected = (size_t) ((level_width + 3) / 4) * ((level_height + 3) / 4) * block_size;
+
+        valid = offset <= size && length <= size - offset && length == expected;
+        chain->levels[i] = (mip_level) {
+            .offset = offset,
+            .size = length,
+            .width = level_width,
+            .height = level_height
+        };
+    }
+
+    if (!valid)
+    {
+        munmap(base, size);
+        return false;
+    }
+
+    chain->data = base;
+    chain->size = size;
+    chain->channels = 0;
+    chain->level_count = levels;
+
+    file->vk_format = vk_format;
+    file->bottom_up = kvd_length > 0 && ktx2_parse_bottom_up(base + kvd_offset, kvd_length);
+    file->source_hash = kvd_length > 0 ? ktx2_parse_source_hash(base + kvd_offset, kvd_length) : 0;
+    file->base = base;
+    file->size = size;
+    return true;
+}
+
+void ktx2_unmap(ktx2_file* file)
+{
+    if (file->base)
+        munmap(file->base, file->size);
+    memset(file, 0, sizeof(ktx2_file));
+}
+
+bool ktx2_matches(const ktx2_file* file, bool srgb, bool bottom_up)
+{
+    return ktx2_is_srgb(file->vk_format) == srgb && file->bottom_up == bottom_up;
+}
+
+/**
+ * basic data format descriptor, returns its size
+ */
+static size_t ktx2_write_dfd(unsigned char* out, uint32_t vk_format)
+{
+    size_t block_size = ktx2_block_size(vk_format);
+    bool bc3 = vk_format == KTX2_VK_FORMAT_BC3_UNORM || vk_format == KTX2_VK_FORMAT_BC3_SRGB;
+    bool bc7 = vk_format == KTX2_VK_FORMAT_BC7_UNORM || vk_format == KTX2_VK_FORMAT_BC7_SRGB;
+    int samples = bc3 ? 2 : 1;
+    uint32_t block_length = 24 + 16 * samples;
+
+    unsigned char* p = out;
+    p = ktx2_put_u32(p, 4 + block_length);
+    p = ktx2_put_u32(p, 0);                  // vendor khronos, descriptor type basic
+    p = ktx2_put_u32(p, 2 | (block_length << 16));
+    *p++ = bc3 ? KHR_DF_MODEL_BC3 : (bc7 ? KHR_DF_MODEL_BC7 : KHR_DF_MODEL_BC1A);
+    *p++ = KHR_DF_PRIMARIES_BT709;
+    *p++ = ktx2_is_srgb(vk_format) ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR;
+    *p++ = 0;                                // straight alpha
+    *p++ = 3; *p++ = 3; *p++ = 0; *p++ = 0;  // 4x4x1x1 texel block, stored minus one
+    memset(p, 0, 8);
+    p[0] = (unsigned char) block_size;
+    p += 8;
+
+    // one sample per independently compressed part of the block
+    for (int s = 0; s < samples; s++)
+    {
+        bool alpha = bc3 && s == 0;
+        uint16_t bit_offset = bc3 && s == 1 ? 64 : 0;
+        uint8_t bit_length = (bc3 || !bc7) ? 63 : 127;
+
+        *p++ = bit_offset & 0xff;
+        *p++ = bit_offset >> 8;
+        *p++ = bit_length;
+        *p++ = alpha ? KHR_DF_CHANNEL_BC3_ALPHA : KHR_DF_CHANNEL_COLOR;
+        p = ktx2_put_u32(p, 0);             // sample position
+        p = ktx2_put_u32(p, 0);
+        p = ktx2_put_u32(p, UINT32_MAX);
+    }
+
+    return p - out;
+}
+
+/**
+ * one key/value pair with its padding, value includes its terminating zero, returns the end
+ */
+static unsigned char* ktx2_put_pair(unsigned char* p, const char* key, const char* value, size_t value_length)
+{
+    size_t key_length = strlen(key) + 1;
+    uint32_t pair_length = key_length + value_length;
+    p = ktx2_put_u32(p, pair_length);
+    memcpy(p, key, key_length);
+    memcpy(p + key_length, value, value_length);
+    return p + ((pair_length + 3) & ~3u);
+}
+
+bool ktx2_write(const char* path, uint32_t vk_format, bool bottom_up, uint64_t source_hash, const mip_chain* chain)
+{
+    size_t block_size = ktx2_block_size(vk_format);
+    if (block_size == 0 || chain->level_count < 1)
+        return false;
+
+    unsigned char meta[1024] = {0};
+    size_t dfd_offset = KTX2_HEADER_SIZE + chain->level_count * KTX2_LEVEL_INDEX_SIZE;
+    size_t dfd_length = ktx2_write_dfd(meta + dfd_offset, vk_format);
+
+    // pairs sorted by key as the spec asks, uppercase before lowercase
+    char source_hash_value[17];
+    snprintf(source_hash_value, sizeof(source_hash_value), "%016" PRIx64, source_hash);
+    size_t kvd_offset = dfd_offset + dfd_length;
+    unsigned char* kvd = ktx2_put_pair(meta + kvd_offset, KTX2_ORIENTATION_KEY, bottom_up ? "ru" : "rd", 3);
+    kvd = ktx2_put_pair(kvd, KTX2_SOURCE_HASH_KEY, source_hash_value, sizeof(source_hash_value));
+    size_t kvd_length = kvd - (meta + kvd_offset);
+
+    // levels start aligned to lcm(block size, 4), smallest level first in the file
+    size_t offset = kvd_offset + kvd_length;
+    size_t level_offsets[MIPMAP_MAX_LEVELS];
+    for (int i = chain->level_count - 1; i >= 0; i--)
+    {
+        offset = (offset + block_size - 1) & ~(block_size - 1);
+        level_offsets[i] = offset;
+        offset += chain->levels[i].size;
+    }
+
+    unsigned char* p = meta;
+    memcpy(p, ktx2_identifier, sizeof(ktx2_identifier));
+    p += sizeof(ktx2_identifier);
+    p = ktx2_put_u32(p, vk_format);
+    p = ktx2_put_u32(p, 1);                  // type size of compressed formats
+    p = ktx2_put_u32(p, chain->levels[0].width);
+    p = ktx2_put_u32(p, chain->levels[0].height);
+    p = ktx2_put_u32(p, 0);                  // depth
+    p = ktx2_put_u32(p, 0);                  // layers
+    p = ktx2_put_u32(p, 1);                  // faces
+    p = ktx2_put_u32(p, chain->level_count);
+    p = ktx2_put_u32(p, 0);                  // no supercompression
+    p = ktx2_put_u32(p, dfd_offset);
+    p = ktx2_put_u32(p, dfd_length);
+    p = ktx2_put_u32(p, kvd_offset);
+    p = ktx2_put_u32(p, kvd_length);
+    p = ktx2_put_u64(p, 0);                  // no supercompression global data
+    p = ktx2_put_u64(p, 0);
+    for (int i = 0; i < chain->level_count; i++)
+    {
+        p = ktx2_put_u64(p, level_offsets[i]);
+        p = ktx2_put_u64(p, chain->levels[i].size);
+        p = ktx2_put_u64(p, 0);              // uncompressed length, only for supercompression
+    }
+
+    FILE* f = fopen(path, "wb");
+    if (f == NULL)
+    {
+        perror("failed to open file: ");
+        return false;
+    }
+
+    static const unsigned char padding[16] = {0};
+    bool ok = fwrite(meta, 1, kvd_offset + kvd_length, f) == kvd_offset + kvd_length;
+    size_t written = kvd_offset + kvd_length;
+    for (int i = chain->level_count - 1; i >= 0 && ok; i--)
+    {
+        size_t pad = level_offsets[i] - written;
+        const mip_level* level = &chain->levels[i];
+        ok = fwrite(padding, 1, pad, f) == pad
+          && fwrite(chain->data + level->offset, 1, level->size, f) == level->size;
+        written = level_offsets[i] + level->size;
+    }
+
+    ok = fclose(f) == 0 && ok;
+    if (!ok)
+        my_log(ERRMSG("failed to write KTX2 file: ") PATHMSG("%s\n"), path);
+
+    return ok;
+}
@@ -0,0 +1,59 @@
+#ifndef __KTX2_H__
+#define __KTX2_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mipmap.h"
+
+// compressed texture sits next to its source image: awesomeface.png -> awesomeface.png.ktx2
+#define KTX2_EXTENSION ".ktx2"
+
+// VkFormat values of the block compressed formats we write and load
+#define KTX2_VK_FORMAT_BC1_RGB_UNORM   131
+#define KTX2_VK_FORMAT_BC1_RGB_SRGB    132
+#define KTX2_VK_FORMAT_BC3_UNORM       137
+#define KTX2_VK_FORMAT_BC3_SRGB        138
+#define KTX2_VK_FORMAT_BC7_UNORM       145
+#define KTX2_VK_FORMAT_BC7_SRGB        146
+
+// read-only mapping of a KTX2 file, level offsets of chain are from start of the file
+typedef struct ktx2_file
+{
+    uint32_t vk_format;
+    // KTXorientation "ru": first row is the bottom one, ready for GL without flipping
+    bool bottom_up;
+    // hash_fnv1a() of the source image contents it was converted from, 0 when the file does not say
+    uint64_t source_hash;
+    mip_chain chain;
+    void* base;
+    size_t size;
+} ktx2_file;
+
+/**
+ * writes path of the compressed file of source_path into out, .ktx2 appended to the full name
+ */
+void ktx2_path(const char* source_path, char* out, size_t out_size);
+
+/**
+ * maps a KTX2 file with a single 2D image and its mip levels
+ * supercompressed, array, cubemap and 3D files are rejected
+ */
+bool ktx2_map(const char* path, ktx2_file* file);
+
+void ktx2_unmap(ktx2_file* file);
+
+/**
+ * whether the file holds what a load asks for: sRGB or linear colors and bottom-up or top-down rows
+ * a mismatched file would be sampled too dark / washed out or upside down
+ */
+bool ktx2_matches(const ktx2_file* file, bool srgb, bool bottom_up);
+
+/**
+ * writes chain of block compressed levels (level size = compressed bytes)
+ * source_hash is stored in the key/value data so loaders can tell a stale file from its source
+ */
+bool ktx2_write(const char* path, uint32_t vk_format, bool bottom_up, uint64_t source_hash, const mip_chain* chain);
+
+#endif // __KTX2_H__
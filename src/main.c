@@ -1,14 +1,25 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <cglm/cglm.h>
 
-#define STB_IMAGE_IMPLEMENTATION
-#include "./vendor/stb_image.h"
-
 #include "utils.h"
+#include "frame_uniforms.h"
+#include "gl_ext.h"
+#include "glb.h"
+#include "obj.h"
+#include "shader.h"
+#include "shader_preprocessor.h"
+#include "shader_reflection.h"
+#include "shader_stats.h"
+#include "shader_watch.h"
+#include "texture.h"
+#include "transform.h"
+#include "vertex_format.h"
 
 #define ENABLE_LOGS
 #include "debug.h"
@@ -19,16 +30,21 @@
 #define VIEWPORT_WIDTH WINDOW_WIDTH
 #define VIEWPORT_HEIGHT WINDOW_HEIGHT
 
-#define SHADER_ERROR_LOG_SIZE 512
-
-bool create_shader(unsigned int* shader_obj, GLenum shader_type, const char* path);
-
-void check_program_linking(unsigned int shader_program);
+// features hlavního programu jsou v Makefile (MAIN_PROGRAM_FEATURES), aby target spirv předkompiloval stejnou variantu
+// PRECOMPUTED_MVP: MVP se počítá na CPU jednou za objekt, vertex shader ho jen použije
+// QUANTIZED_POSITION: pozice vertexů dekóduje shader podle vertex_format
+#ifndef MAIN_PROGRAM_FEATURES
+#error "MAIN_PROGRAM_FEATURES is set by the Makefile"
+#endif
+// stejný text, jaký vkládá shader_spirv -D
+#define MAIN_PROGRAM_FEATURE(name) "#define " #name " 1\n"
+#define MAIN_PROGRAM_DEFINES MAIN_PROGRAM_FEATURES
 
 void init(GLFWwindow** window);
 void process_input(GLFWwindow *window);
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void clean_up();
+void setup_uniforms(unsigned int program, mat4 model);
 
 // triangle
 float vertices[] = {
@@ -44,14 +60,29 @@ unsigned int indices[] = {
     1,2,3
 };
 
-int main(void)
+int main(int argc, char** argv)
 {
     GLFWwindow* window;
     init(&window);
 
-    unsigned int main_program;
-    unsigned int vert_shader;
-    unsigned int frag_shader;
+    unsigned int main_program = 0;
+
+    #pragma region shader program creation
+    // shadery jsou zkompilované do binárky, debug build je čte z disku a při změně je přenačte
+#ifdef SHADER_HOT_RELOAD
+    shader_preprocess_set_mode(SHADER_SOURCE_DISK);
+    shader_watch_init();
+#endif
+    // vertexy se do bufferu ukládají zkvantované (16 B místo 32 B), varianta shaderu je dekóduje
+    vertex_format format = VERTEX_FORMAT_COMPACT;
+    my_assert(strstr(MAIN_PROGRAM_DEFINES, vertex_format_defines(format)), "MAIN_PROGRAM_FEATURES do not decode the vertex format");
+
+    // všechny programy se překládají najednou na pozadí, do té doby běží zbytek inicializace i render loop
+    // po prvním spuštění se program načítá z binární cache
+    shader_batch_t* shaders = shader_batch_create();
+    int main_program_build = shader_batch_add(shaders, "./shaders/vertex.vert", "./shaders/fragment.frag", MAIN_PROGRAM_DEFINES);
+    shader_batch_submit(shaders);
+    #pragma endregion
 
     // vertex buffer object
     // vertex array object (holds VBO configuration)
@@ -68,54 +99,52 @@ int main(void)
     glBindVertexArray(VAO);
     
     // 3. copy our data to buffers for OpenGL to use
+    // model z příkazové řádky (huh model.obj) má stejný layout vertexů jako čtverec, bez něj se kreslí čtverec
+    // .glb má vlastní buffery a VAO, atributy si nastaví podle accessorů bez převodu
+    obj_mesh mesh = { 0 };
+    glb_model glb = { 0 };
+    size_t model_path_length = argc > 1 ? strlen(argv[1]) : 0;
+    bool model_is_glb = model_path_length > 4 && strcmp(argv[1] + model_path_length - 4, ".glb") == 0;
+    if (argc > 1 && !(model_is_glb ? glb_load(argv[1], &glb) : obj_load(argv[1], 0, &mesh)))
+        my_log(WARRMSG("drawing the quad instead of: ") PATHMSG("%s\n"), argv[1]);
+    GLsizei index_count = mesh.indices ? (GLsizei) mesh.index_count : (GLsizei) (sizeof(indices) / sizeof(indices[0]));
+
+    // pozice se kvantují v rámci bounding boxu meshe, decode z něj převádí zpátky
+    const float* source_vertices = mesh.vertices ? mesh.vertices : vertices;
+    size_t vertex_count = mesh.vertices ? mesh.vertex_count : sizeof(vertices) / (sizeof(float) * OBJ_VERTEX_FLOATS);
+    vertex_source source = { source_vertices, source_vertices + 3, source_vertices + 6, NULL, OBJ_VERTEX_FLOATS };
+    // opakované (tiled) nebo záporné UV se do unorm16 nevejdou, formát se jim přizpůsobí
+    format = vertex_format_fit(format, &source, vertex_count);
+    vertex_position_decode decode;
+    void* packed = malloc(vertex_count * vertex_format_stride(format));
+    my_assert(packed, "failed to allocate vertices");
+    vertex_format_pack(format, &source, vertex_count, packed, &decode);
+
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, vertex_count * vertex_format_stride(format), packed, GL_STATIC_DRAW);
+    free(packed);
     gl_check_error();
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    if (mesh.indices)
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.index_count * sizeof(uint32_t), mesh.indices, GL_STATIC_DRAW);
+    else
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
     gl_check_error();
+    obj_mesh_free(&mesh);
 
     // Attribute configuration
-    // position
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    // color
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*) (sizeof(float)*3));
-    glEnableVertexAttribArray(1);
-
-    // tex coord
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*) (sizeof(float) * 6));
-    glEnableVertexAttribArray(2);
+    // position, color a tex coord podle formátu, normalizované typy převádí na float už při načtení vertexu
+    vertex_format_setup(format, 0);
 
     // Textury
-    unsigned int texture1, texture2;
-    glGenTextures(1, &texture1);
-    glGenTextures(1, &texture2);
-
-    stbi_set_flip_vertically_on_load(true);
-
-    glBindTexture(GL_TEXTURE_2D, texture1);
-    // textura se opakuje na x i na y
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-    // při přechodu na nižší textury 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    // přechod na vyšší
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    int width, height, channels;
-    unsigned char* data =  stbi_load("./resources/textures/awesomeface.png", &width, &height, &channels, 0);
-    my_assert(data, "Failed to load image");
-
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    stbi_image_free(data);
-    
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture1);
+    // dekódování běží na worker vláknech, do nahrání je navázaná placeholder textura
+    texture_system_init(0);
+    texture_streaming_init(TEXTURE_STREAM_SLOTS, TEXTURE_STREAM_SLOT_SIZE);
+    texture_set_budget(TEXTURE_BUDGET_DEFAULT);
+    texture_params params = TEXTURE_PARAMS_DEFAULT;
+    params.progressive = true;
+    texture_handle texture1 = texture_load_async("./resources/textures/awesomeface.png", params);
 
     // Matice
     // Transformace a jejich uniformy
@@ -138,43 +167,14 @@ int main(void)
     glm_translate(view, (vec3){0,0,-10});
 
     glm_perspective(glm_rad(45),(float) WINDOW_WIDTH/(float) WINDOW_HEIGHT, 0.1, 100.0f, projection);
-    
-
-    #pragma region shader program creation
-    my_assert(create_shader(&vert_shader, GL_VERTEX_SHADER, "./shaders/vertex.vert"), "failed to create VETEXE SHADER");
-    my_assert(create_shader(&frag_shader, GL_FRAGMENT_SHADER, "./shaders/fragment.frag"), "failed to create FRAGMENT SHADER");
-
-    main_program = glCreateProgram();
-
-    // Attach shader stages
-    glAttachShader(main_program, vert_shader);
-    gl_check_error();
-
-    glAttachShader(main_program, frag_shader);
-    gl_check_error();
-
-    // link shader stages
-    glLinkProgram(main_program);
-    check_program_linking(main_program);
-
-    // remove now uneneccesary shaders
-    glDeleteShader(vert_shader);
-    glDeleteShader(frag_shader);
-    #pragma endregion
-
-    glUseProgram(main_program);
-
-    // Uniforms
-    glUniformMatrix4fv(glGetUniformLocation(main_program, "model"), 1, GL_FALSE, model[0]);
-    gl_check_error();
-    glUniformMatrix4fv(glGetUniformLocation(main_program, "view"), 1, GL_FALSE, view[0]);
-    gl_check_error();
-    glUniformMatrix4fv(glGetUniformLocation(main_program, "projection"), 1, GL_FALSE, projection[0]);
-    gl_check_error();
-
-
-    glUniform1i(glGetUniformLocation(main_program, "texture1"), 0); // assign texture 0
 
+    // view a projection sdílí všechny programy přes jeden uniform buffer, nahrává se jednou za snímek
+    frame_uniforms_init();
+    frame_uniforms frame = { 0 };
+    memcpy(frame.view, view, sizeof(mat4));
+    memcpy(frame.projection, projection, sizeof(mat4));
+    float last_time = (float) glfwGetTime();
+    
 
     // set clear color
     glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
@@ -185,77 +185,68 @@ int main(void)
     while(!glfwWindowShouldClose(window))
     {
         process_input(window);
+        texture_update();
         glClear(GL_COLOR_BUFFER_BIT);
 
+        int width, height;
+        glfwGetFramebufferSize(window, &width, &height);
+        frame.time = (float) glfwGetTime();
+        frame.delta_time = frame.time - last_time;
+        frame.viewport[0] = (float) width;
+        frame.viewport[1] = (float) height;
+        last_time = frame.time;
+        frame_uniforms_update(&frame);
+
+        // view_projection*model jednou za objekt (kernel bere celé pole modelů), ve shaderu zbývá jedno násobení na vertex
+        mat4 mvp;
+        transform_mvp_batch(frame.view_projection, model[0], mvp[0], 1);
+
+        // program is picked up in the frame the driver finishes it
+        if (main_program == 0 && shader_batch_poll(shaders))
+        {
+            main_program = shader_batch_program(shaders, main_program_build);
+            my_assert(main_program, "failed to create SHADER PROGRAM");
+            shader_batch_destroy(shaders);
+
+            // po uložení shaderu se program přeloží na pozadí a vymění, až se úspěšně slinkuje
+            shader_watch_add(&main_program, "./shaders/vertex.vert", "./shaders/fragment.frag", MAIN_PROGRAM_DEFINES, NULL, NULL);
+            setup_uniforms(main_program, model);
+        }
+        // nový program nemá nastavené uniformy
+        else if (shader_watch_update())
+            setup_uniforms(main_program, model);
+
+        texture_bind(texture1, 0);
+
         //glDrawArrays(GL_TRIANGLES, 0, 3);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        if (main_program)
+        {
+            glUseProgram(main_program);
+            transform_upload(main_program, mvp[0], NULL);
+            if (glb.primitive_count)
+            {
+                // .glb má atributy tak, jak jsou v souboru, pozice nejsou zkvantované
+                vertex_format_upload_decode(main_program, &VERTEX_POSITION_DECODE_IDENTITY);
+                glb_draw(&glb);
+            }
+            else
+            {
+                vertex_format_upload_decode(main_program, &decode);
+                glBindVertexArray(VAO);
+                glDrawElements(GL_TRIANGLES, index_count, GL_UNSIGNED_INT, 0);
+            }
+        }
     
         glfwPollEvents();
         glfwSwapBuffers(window);
     }
 
-    return 0;
-}
-
-/**
- * creates, compiles and checks for shader errors
- */
-bool create_shader(unsigned int* shader_obj, GLenum shader_type, const char* path)
-{
-    FILE* f_shader_src = fopen(path, "r");
-    if (f_shader_src == NULL)
-    {
-        perror("failed to open file: ");
-        return false;
-    }
-    
-    fseek(f_shader_src, 0, SEEK_END);
-    long size = ftell(f_shader_src);
-    fseek(f_shader_src, 0, SEEK_SET);
-    
-    char* shader_src = malloc(size + 1);
-    fread(shader_src, 1, size, f_shader_src);
-    shader_src[size] = '\0';
-
-    *shader_obj = glCreateShader(shader_type);
-    
-    glShaderSource(*shader_obj, 1, (const GLchar * const*) &shader_src, NULL);
-    gl_check_error();
-    
-    glCompileShader(*shader_obj);
-    gl_check_error();
-    
-    int success;
-    char info_log[SHADER_ERROR_LOG_SIZE];
-    glGetShaderiv(*shader_obj, GL_COMPILE_STATUS, &success);
-    gl_check_error();
-    
-    if(!success)
-    {
-        glGetShaderInfoLog(*shader_obj, SHADER_ERROR_LOG_SIZE, NULL, info_log);
-        my_log(ERRMSG("failed to compile SHADER:VERTEX")"\nerror messages:\n%s\n", info_log);
-        return false;
-    }
-
-    return true;
-
-}
-
-
-// Error checking
-void check_program_linking(unsigned int shader_program)
-{
-    int success;
-    char info_log[SHADER_ERROR_LOG_SIZE];
-    glGetProgramiv(shader_program, GL_LINK_STATUS, &success);
-    gl_check_error();
-    
-    if(!success)
-    {
-        glGetShaderInfoLog(shader_program, SHADER_ERROR_LOG_SIZE, NULL, info_log);
-        my_log(ERRMSG("failed to link SHADERS in program")"\nerror messages:\n%s\n", info_log);
-    }
+    // okno zavřeno dřív, než se program stihl sestavit
+    if (main_program == 0)
+        shader_batch_destroy(shaders);
+    glb_free(&glb);
 
+    return 0;
 }
 
 // Callbacks
@@ -274,6 +265,7 @@ void init(GLFWwindow** window)
     glfwMakeContextCurrent(*window);
     
     my_assert(gladLoadGLLoader((GLADloadproc)glfwGetProcAddress), "failed to initialize GLAD");
+    gl_ext_init((GLADloadproc) glfwGetProcAddress);
 
     glViewport(0, 0, VIEWPORT_WIDTH, VIEWPORT_HEIGHT);
 
@@ -304,8 +296,27 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
     glViewport(0, 0, width, height);
 }  
 
+void setup_uniforms(unsigned int program, mat4 model)
+{
+    glUseProgram(program);
+
+    // Uniforms
+    // lokace jsou zjištěné už při linkování, hledají se podle id bez řetězců
+    glUniformMatrix4fv(shader_uniform_location(program, SHADER_UNIFORM_MODEL), 1, GL_FALSE, model[0]);
+    gl_check_error();
+
+    glUniform1i(shader_uniform_location(program, SHADER_UNIFORM_TEXTURE1), 0); // assign texture 0
+}
+
 void clean_up()
 {
+    // časy překladu a linkování všech programů, nejdražší nahoře
+    shader_stats_dump();
+    shader_stats_clear();
+    shader_watch_shutdown();
+    shader_reflection_shutdown();
+    frame_uniforms_shutdown();
+    texture_system_shutdown();
     gl_check_error();
     glfwTerminate();
     my_log("cleaned up\n");
@@ -0,0 +1,332 @@
+#include "mipmap.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MIPMAP_X86
+#include <immintrin.h>
+#endif
+
+// linear -> sRGB encode table resolution, keeps the error under 0.25 of an 8-bit step near black
+#define MIPMAP_SRGB_ENCODE_SIZE 16384
+
+/**
+ * filters one destination row from two source rows (same row twice for 1 pixel tall sources)
+ * sources hold at least 2 * dst_width pixels unless src_width == 1
+ */
+typedef void (*mipmap_row_fn)(const unsigned char* row0, const unsigned char* row1, unsigned char* dst,
+                              int dst_width, int src_width, int channels);
+
+static struct
+{
+    pthread_once_t once;
+    // [0, 256) sRGB -> linear, [256, 512) alpha / 255, laid out for one gather per pixel
+    float decode[512];
+    uint32_t encode[MIPMAP_SRGB_ENCODE_SIZE];
+    mipmap_row_fn linear_rgba;
+    mipmap_row_fn srgb_rgba;
+} mipmap = { .once = PTHREAD_ONCE_INIT };
+
+#pragma region scalar
+static void mipmap_row_linear_scalar(const unsigned char* row0, const unsigned char* row1, unsigned char* dst,
+                                     int dst_width, int src_width, int channels)
+{
+    for (int x = 0; x < dst_width; x++)
+    {
+        int x0 = x * 2;
+        int x1 = x0 + 1 < src_width ? x0 + 1 : x0;
+
+        for (int c = 0; c < channels; c++)
+        {
+            unsigned int sum = row0[x0 * channels + c] + row0[x1 * channels + c]
+                             + row1[x0 * channels + c] + row1[x1 * channels + c];
+            dst[x * channels + c] = (unsigned char) ((sum + 2) / 4);
+        }
+    }
+}
+
+static unsigned char mipmap_encode_srgb(float linear)
+{
+    int index = (int) (linear * (MIPMAP_SRGB_ENCODE_SIZE - 1) + 0.5f);
+    return (unsigned char) mipmap.encode[index];
+}
+
+/**
+ * color channels are averaged in linear light, alpha (4th channel, 2nd for gray + alpha) stays linear
+ */
+static void mipmap_row_srgb_scalar(const unsigned char* row0, const unsigned char* row1, unsigned char* dst,
+                                   int dst_width, int src_width, int channels)
+{
+    int alpha = (channels == 2 || channels == 4) ? channels - 1 : -1;
+
+    for (int x = 0; x < dst_width; x++)
+    {
+        int x0 = x * 2;
+        int x1 = x0 + 1 < src_width ? x0 + 1 : x0;
+
+        for (int c = 0; c < channels; c++)
+        {
+            const unsigned char* a = row0 + x0 * channels + c;
+            const unsigned char* b = row0 + x1 * channels + c;
+            const unsigned char* d = row1 + x0 * channels + c;
+            const unsigned char* e = row1 + x1 * channels + c;
+
+            if (c == alpha)
+            {
+                dst[x * channels + c] = (unsigned char) ((*a + *b + *d + *e + 2) / 4);
+            }
+            else
+            {
+                float sum = mipmap.decode[*a] + mipmap.decode[*b] + mipmap.decode[*d] + mipmap.decode[*e];
+                dst[x * channels + c] = mipmap_encode_srgb(sum * 0.25f);
+            }
+        }
+    }
+}
+#pragma endregion
+
+#ifdef MIPMAP_X86
+#pragma region SSE2
+/**
+ * 4 source pixels of both rows -> 2 RGBA pixels per iteration
+ */
+static void mipmap_row_linear_rgba_sse2(const unsigned char* row0, const unsigned char* row1, unsigned char* dst,
+                                        int dst_width, int src_width, int channels)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi16(2);
+    int x = 0;
+
+    for (; x + 2 <= dst_width; x += 2)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*) (row0 + x * 8));
+        __m128i b = _mm_loadu_si128((const __m128i*) (row1 + x * 8));
+
+        // vertical sums of pixels 0,1 and 2,3 in 16-bit lanes
+        __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+        __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+
+        // horizontal neighbours sit 8 bytes apart
+        lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+        hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+
+        __m128i sum = _mm_unpacklo_epi64(lo, hi);
+        sum = _mm_srli_epi16(_mm_add_epi16(sum, round), 2);
+        _mm_storel_epi64((__m128i*) (dst + x * 4), _mm_packus_epi16(sum, sum));
+    }
+
+    mipmap_row_linear_scalar(row0 + x * 8, row1 + x * 8, dst + x * 4, dst_width - x, src_width - x * 2, channels);
+}
+#pragma endregion
+
+#pragma region AVX2
+/**
+ * 8 source pixels of both rows -> 4 RGBA pixels per iteration
+ */
+__attribute__((target("avx2")))
+static void mipmap_row_linear_rgba_avx2(const unsigned char* row0, const unsigned char* row1, unsigned char* dst,
+                                        int dst_width, int src_width, int channels)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i round = _mm256_set1_epi16(2);
+    int x = 0;
+
+    for (; x + 4 <= dst_width; x += 4)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i*) (row0 + x * 8));
+        __m256i b = _mm256_loadu_si256((const __m256i*) (row1 + x * 8));
+
+        // unpacks work per 128-bit lane: lo = pixels 0,1 | 4,5, hi = 2,3 | 6,7
+        __m256i lo = _mm256_add_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero));
+        __m256i hi = _mm256_add_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero));
+
+        lo = _mm256_add_epi16(lo, _mm256_srli_si256(lo, 8));
+        hi = _mm256_add_epi16(hi, _mm256_srli_si256(hi, 8));
+
+        __m256i sum = _mm256_unpacklo_epi64(lo, hi);
+        sum = _mm256_srli_epi16(_mm256_add_epi16(sum, round), 2);
+
+        // lane 0 holds output 0,1 and lane 1 output 2,3, pull both into the low 128 bits
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(sum, sum), _MM_SHUFFLE(3, 1, 2, 0));
+        _mm_storeu_si128((__m128i*) (dst + x * 4), _mm256_castsi256_si128(packed));
+    }
+
+    mipmap_row_linear_rgba_sse2(row0 + x * 8, row1 + x * 8, dst + x * 4, dst_width - x, src_width - x * 2, channels);
+}
+
+/**
+ * gathers 2 pixels (8 channels) from the decode table, alpha lanes index the linear half
+ */
+__attribute__((target("avx2")))
+static __m256 mipmap_gather_linear(const unsigned char* p)
+{
+    const __m256i alpha_offset = _mm256_setr_epi32(0, 0, 0, 256, 0, 0, 0, 256);
+    __m128i bytes = _mm_loadl_epi64((const __m128i*) p);
+    __m256i index = _mm256_add_epi32(_mm256_cvtepu8_epi32(bytes), alpha_offset);
+    return _mm256_i32gather_ps(mipmap.decode, index, 4);
+}
+
+/**
+ * 2 RGBA pixels per iteration, color in linear light through gathers, alpha linear
+ */
+__attribute__((target("avx2")))
+static void mipmap_row_srgb_rgba_avx2(const unsigned char* row0, const unsigned char* row1, unsigned char* dst,
+                                      int dst_width, int src_width, int channels)
+{
+    const __m256 quarter = _mm256_set1_ps(0.25f);
+    const __m256 encode_scale = _mm256_set1_ps(MIPMAP_SRGB_ENCODE_SIZE - 1);
+    const __m256 alpha_scale = _mm256_set1_ps(255.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 alpha_mask = _mm256_castsi256_ps(_mm256_setr_epi32(0, 0, 0, -1, 0, 0, 0, -1));
+    int x = 0;
+
+    for (; x + 2 <= dst_width; x += 2)
+    {
+        const unsigned char* a = row0 + x * 8;
+        const unsigned char* b = row1 + x * 8;
+
+        // pixels 0,1 and 2,3 of both rows
+        __m256 a01 = mipmap_gather_linear(a), a23 = mipmap_gather_linear(a + 8);
+        __m256 b01 = mipmap_gather_linear(b), b23 = mipmap_gather_linear(b + 8);
+
+        __m256 v01 = _mm256_add_ps(a01, b01);
+        __m256 v23 = _mm256_add_ps(a23, b23);
+        // (0 + 1, 2 + 3): swap 128-bit halves to line the horizontal pairs up
+        __m256 left = _mm256_permute2f128_ps(v01, v23, 0x20);
+        __m256 right = _mm256_permute2f128_ps(v01, v23, 0x31);
+        __m256 sum = _mm256_mul_ps(_mm256_add_ps(left, right), quarter);
+
+        __m256i color_index = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(sum, encode_scale), half));
+        __m256i color = _mm256_i32gather_epi32((const int*) mipmap.encode, color_index, 4);
+        __m256i alpha = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(sum, alpha_scale), half));
+        __m256i result = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(color), _mm256_castsi256_ps(alpha), alpha_mask));
+
+        __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(result), _mm256_extracti128_si256(result, 1));
+        _mm_storel_epi64((__m128i*) (dst + x * 4), _mm_packus_epi16(words, words));
+    }
+
+    mipmap_row_srgb_scalar(row0 + x * 8, row1 + x * 8, dst + x * 4, dst_width - x, src_width - x * 2, channels);
+}
+#pragma endregion
+#endif // MIPMAP_X86
+
+static void mipmap_init_once(void)
+{
+    for (int i = 0; i < 256; i++)
+    {
+        float c = i / 255.0f;
+        mipmap.decode[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+        mipmap.decode[256 + i] = c;
+    }
+
+    for (int i = 0; i < MIPMAP_SRGB_ENCODE_SIZE; i++)
+    {
+        float l = (float) i / (MIPMAP_SRGB_ENCODE_SIZE - 1);
+        float c = l <= 0.0031308f ? l * 12.92f : 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+        mipmap.encode[i] = (uint32_t) lrintf(c * 255.0f);
+    }
+
+    mipmap.linear_rgba = mipmap_row_linear_scalar;
+    mipmap.srgb_rgba = mipmap_row_srgb_scalar;
+
+#ifdef MIPMAP_X86
+    mipmap.linear_rgba = mipmap_row_linear_rgba_sse2;
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        mipmap.linear_rgba = mipmap_row_linear_rgba_avx2;
+        mipmap.srgb_rgba = mipmap_row_srgb_rgba_avx2;
+    }
+#endif
+}
+
+int mipmap_level_count(int width, int height)
+{
+    int levels = 1;
+    while ((width > 1 || height > 1) && levels < MIPMAP_MAX_LEVELS)
+    {
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+        levels++;
+    }
+    return levels;
+}
+
+void mip_chain_layout(mip_chain* chain, int width, int height, int channels, bool full_chain)
+{
+    chain->channels = channels;
+    chain->level_count = full_chain ? mipmap_level_count(width, height) : 1;
+
+    size_t offset = 0;
+    for (int i = 0; i < chain->level_count; i++)
+    {
+        mip_level* level = &chain->levels[i];
+        level->offset = offset;
+        level->width = width;
+        level->height = height;
+        level->size = (size_t) width * height * channels;
+        offset += level->size;
+
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    chain->size = offset;
+}
+
+/**
+ * 2x2 box filter, 1 pixel wide or tall sources reuse their only column/row
+ */
+static void mipmap_downsample(const unsigned char* src, int src_width, int src_height,
+                              unsigned char* dst, int dst_width, int dst_height, int channels, bool srgb)
+{
+    mipmap_row_fn row_fn;
+    if (channels == 4 && src_width > 1)
+        row_fn = srgb ? mipmap.srgb_rgba : mipmap.linear_rgba;
+    else
+        row_fn = srgb ? mipmap_row_srgb_scalar : mipmap_row_linear_scalar;
+
+    for (int y = 0; y < dst_height; y++)
+    {
+        int y0 = y * 2;
+        int y1 = y0 + 1 < src_height ? y0 + 1 : y0;
+        const unsigned char* row0 = src + (size_t) y0 * src_width * channels;
+        const unsigned char* row1 = src + (size_t) y1 * src_width * channels;
+
+        row_fn(row0, row1, dst + (size_t) y * dst_width * channels, dst_width, src_width, channels);
+    }
+}
+
+bool mip_chain_generate(mip_chain* chain, const unsigned char* base, int width, int height, int channels, bool srgb)
+{
+    pthread_once(&mipmap.once, mipmap_init_once);
+
+    mip_chain_layout(chain, width, height, channels, true);
+
+    chain->data = malloc(chain->size);
+    if (chain->data == NULL)
+        return false;
+
+    memcpy(chain->data, base, chain->levels[0].size);
+
+    for (int i = 1; i < chain->level_count; i++)
+    {
+        const mip_level* src = &chain->levels[i - 1];
+        const mip_level* dst = &chain->levels[i];
+        mipmap_downsample(chain->data + src->offset, src->width, src->height,
+                          chain->data + dst->offset, dst->width, dst->height, channels, srgb);
+    }
+
+    return true;
+}
+
+void mip_chain_free(mip_chain* chain)
+{
+    free(chain->data);
+    chain->data = NULL;
+    chain->size = 0;
+    chain->level_count = 0;
+}
@@ -0,0 +1,51 @@
+#ifndef __MIPMAP_H__
+#define __MIPMAP_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// enough levels for a 32768x32768 base image
+#define MIPMAP_MAX_LEVELS 16
+
+typedef struct mip_level
+{
+    size_t offset;  // byte offset of the level from chain data
+    size_t size;
+    int width;
+    int height;
+} mip_level;
+
+// all levels of one image, tightly packed rows, largest level first
+typedef struct mip_chain
+{
+    unsigned char* data;
+    size_t size;
+    int channels;
+    int level_count;
+    mip_level levels[MIPMAP_MAX_LEVELS];
+} mip_chain;
+
+/**
+ * number of levels down to 1x1
+ */
+int mipmap_level_count(int width, int height);
+
+/**
+ * fills level table of the chain without touching data
+ * full_chain == false lays out only the base level
+ */
+void mip_chain_layout(mip_chain* chain, int width, int height, int channels, bool full_chain);
+
+/**
+ * allocates a full chain, copies base level into it and box filters the rest
+ * srgb sources are filtered in linear light, alpha always linearly
+ * RGBA rows run through SSE2/AVX2 kernels picked at runtime, other layouts use the scalar kernel
+ */
+bool mip_chain_generate(mip_chain* chain, const unsigned char* base, int width, int height, int channels, bool srgb);
+
+/**
+ * frees data allocated by mip_chain_generate
+ */
+void mip_chain_free(mip_chain* chain);
+
+#endif // __MIPMAP_H__
@@ -0,0 +1,666 @@
+#include "obj.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "thread_pool.h"
+
+#define ENABLE_LOGS
+#include "debug.h"
+
+// chunks are cut at line ends, several per worker so uneven ones balance out
+#define OBJ_CHUNKS_PER_THREAD 4
+#define OBJ_MIN_CHUNK_SIZE (256 * 1024)
+
+#define OBJ_POSITION_FLOATS 6  // xyz + rgb
+#define OBJ_NO_TEXCOORD UINT32_MAX
+
+typedef enum obj_line
+{
+    OBJ_LINE_OTHER,
+    OBJ_LINE_POSITION,
+    OBJ_LINE_TEXCOORD,
+    OBJ_LINE_FACE
+} obj_line;
+
+typedef struct obj_corner
+{
+    uint32_t position;
+    uint32_t texcoord;
+} obj_corner;
+
+typedef struct obj_chunk
+{
+    const char* begin;
+    const char* end;
+    // counted by the first pass, their prefix sums tell where the chunk's v and vt lines go
+    size_t position_count;
+    size_t texcoord_count;
+    size_t position_base;
+    size_t texcoord_base;
+    obj_corner* corners;  // 3 per triangle
+    size_t corner_count;
+    size_t corner_capacity;
+    size_t corner_base;   // offset into the index array
+    const char* error;    // first line that failed to parse
+} obj_chunk;
+
+// distinct corners of a range of positions, deduplicated on their own worker
+typedef struct obj_shard
+{
+    uint64_t* keys;       // open addressing, 0 is an empty slot
+    uint32_t* ids;
+    size_t capacity;
+    obj_corner* unique;   // vertex i of the shard, in order of first use
+    size_t count;
+    size_t unique_capacity;
+    size_t vertex_base;
+    uint32_t first_position;  // positions [first_position, end_position) belong to the shard
+    uint32_t end_position;
+} obj_shard;
+
+typedef struct obj_import
+{
+    obj_chunk* chunks;
+    int chunk_count;
+    obj_shard* shards;
+    int shard_count;
+    float* positions;
+    float* texcoords;
+    size_t position_count;
+    size_t texcoord_count;
+    obj_mesh* mesh;
+} obj_import;
+
+typedef struct obj_job
+{
+    obj_import* import;
+    int index;
+} obj_job;
+
+#pragma region parsing
+static inline bool obj_is_blank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline bool obj_is_digit(char c)
+{
+    return (unsigned char) (c - '0') < 10;
+}
+
+static inline const char* obj_skip_blanks(const char* p, const char* end)
+{
+    while (p < end && obj_is_blank(*p))
+        p++;
+    return p;
+}
+
+static obj_line obj_line_kind(const char* p, const char* end)
+{
+    if (end - p >= 2 && p[0] == 'v' && obj_is_blank(p[1]))
+        return OBJ_LINE_POSITION;
+    if (end - p >= 3 && p[0] == 'v' && p[1] == 't' && obj_is_blank(p[2]))
+        return OBJ_LINE_TEXCOORD;
+    if (end - p >= 2 && p[0] == 'f' && obj_is_blank(p[1]))
+        return OBJ_LINE_FACE;
+    return OBJ_LINE_OTHER;
+}
+
+static const double obj_pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/**
+ * decimal number to float without strtod's locale handling and exact rounding,
+ * up to 19 significant digits are kept which is far more than a float holds
+ * returns end of the number, NULL when there is none
+ */
+static const char* obj_parse_float(const char* p, const char* end, float* out)
+{
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool any = false;
+
+    for (; p < end && obj_is_digit(*p); p++)
+    {
+        any = true;
+        if (digits < 19)
+        {
+            mantissa = mantissa * 10 + (*p - '0');
+            digits += mantissa != 0;
+        }
+        else
+            exponent++;
+    }
+    if (p < end && *p == '.')
+    {
+        for (p++; p < end && obj_is_digit(*p); p++)
+        {
+            any = true;
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += mantissa != 0;
+                exponent--;
+            }
+        }
+    }
+    if (!any)
+        return NULL;
+
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        const char* e = p + 1;
+        bool negative_exponent = false;
+        if (e < end && (*e == '-' || *e == '+'))
+            negative_exponent = *e++ == '-';
+
+        if (e < end && obj_is_digit(*e))
+        {
+            int value = 0;
+            for (; e < end && obj_is_digit(*e); e++)
+                if (value < 10000)
+                    value = value * 10 + (*e - '0');
+            exponent += negative_exponent ? -value : value;
+            p = e;
+        }
+    }
+
+    double value = (double) mantissa;
+    for (; exponent > 22; exponent -= 22)
+        value *= 1e22;
+    for (; exponent < -22; exponent += 22)
+        value /= 1e22;
+    value = exponent < 0 ? value / obj_pow10[-exponent] : value * obj_pow10[exponent];
+
+    *out = (float) (negative ? -value : value);
+    return p;
+}
+
+/**
+ * parses at most max floats separated by blanks, returns how many were read
+ */
+static int obj_parse_floats(const char* p, const char* end, float* out, int max)
+{
+    int count = 0;
+    for (p = obj_skip_blanks(p, end); p < end && count < max; p = obj_skip_blanks(p, end))
+    {
+        p = obj_parse_float(p, end, &out[count]);
+        if (p == NULL || (p < end && !obj_is_blank(*p)))
+            return count;
+        count++;
+    }
+    return count;
+}
+
+static const char* obj_parse_index(const char* p, const char* end, long* out)
+{
+    bool negative = p < end && *p == '-';
+    p += negative;
+    if (p >= end || !obj_is_digit(*p))
+        return NULL;
+
+    long value = 0;
+    for (; p < end && obj_is_digit(*p); p++)
+    {
+        value = value * 10 + (*p - '0');
+        if (value > UINT32_MAX)
+            return NULL;
+    }
+    *out = negative ? -value : value;
+    return p;
+}
+
+/**
+ * 1-based absolute or negative relative index to 0-based, defined is the count of elements before this line
+ * returns false when it points outside of the file
+ */
+static bool obj_resolve_index(long index, size_t defined, size_t total, uint32_t* out)
+{
+    long long resolved = index > 0 ? index - 1 : (long long) defined + index;
+    if (index == 0 || resolved < 0 || (size_t) resolved >= total)
+        return false;
+    *out = (uint32_t) resolved;
+    return true;
+}
+
+static void obj_chunk_push(obj_chunk* chunk, obj_corner corner)
+{
+    if (chunk->corner_count == chunk->corner_capacity)
+    {
+        chunk->corner_capacity = chunk->corner_capacity ? chunk->corner_capacity * 2 : 4096;
+        chunk->corners = realloc(chunk->corners, sizeof(obj_corner) * chunk->corner_capacity);
+        my_assert(chunk->corners, "failed to grow obj corners");
+    }
+    chunk->corners[chunk->corner_count++] = corner;
+}
+
+/**
+ * "f v v v ...", every corner may also be v/vt, v//vn or v/vt/vn, polygons become triangle fans
+ */
+static bool obj_parse_face(const obj_import* import, obj_chunk* chunk, const char* p, const char* end,
+                           size_t positions_defined, size_t texcoords_defined)
+{
+    obj_corner first = { 0 }, previous = { 0 };
+    int corner_count = 0;
+
+    for (p = obj_skip_blanks(p, end); p < end; p = obj_skip_blanks(p, end))
+    {
+        long index;
+        obj_corner corner = { .texcoord = OBJ_NO_TEXCOORD };
+
+        p = obj_parse_index(p, end, &index);
+        if (p == NULL || !obj_resolve_index(index, positions_defined, import->position_count, &corner.position))
+            return false;
+
+        if (p < end && *p == '/')
+        {
+            p++;
+            if (p < end && *p != '/')
+            {
+                p = obj_parse_index(p, end, &index);
+                if (p == NULL || !obj_resolve_index(index, texcoords_defined, import->texcoord_count, &corner.texcoord))
+                    return false;
+            }
+            // normals are not part of the vertex layout
+            if (p < end && *p == '/')
+            {
+                p = obj_parse_index(p + 1, end, &index);
+                if (p == NULL)
+                    return false;
+            }
+        }
+        if (p < end && !obj_is_blank(*p))
+            return false;
+
+        if (corner_count == 0)
+            first = corner;
+        else if (corner_count >= 2)
+        {
+            obj_chunk_push(chunk, first);
+            obj_chunk_push(chunk, previous);
+            obj_chunk_push(chunk, corner);
+        }
+        previous = corner;
+        corner_count++;
+    }
+    return corner_count >= 3;
+}
+#pragma endregion
+
+#pragma region jobs
+/**
+ * first pass, only v and vt lines are counted so the second pass knows where to store them
+ */
+static void obj_count_job(void* arg)
+{
+    obj_job* job = arg;
+    obj_chunk* chunk = &job->import->chunks[job->index];
+
+    for (const char* line = chunk->begin; line < chunk->end;)
+    {
+        const char* newline = memchr(line, '\n', chunk->end - line);
+        const char* end = newline ? newline : chunk->end;
+
+        obj_line kind = obj_line_kind(obj_skip_blanks(line, end), end);
+        chunk->position_count += kind == OBJ_LINE_POSITION;
+        chunk->texcoord_count += kind == OBJ_LINE_TEXCOORD;
+
+        line = newline ? newline + 1 : chunk->end;
+    }
+}
+
+static void obj_parse_job(void* arg)
+{
+    obj_job* job = arg;
+    obj_import* import = job->import;
+    obj_chunk* chunk = &import->chunks[job->index];
+
+    // counts of elements defined so far in the whole file, relative indices count back from them
+    size_t positions = chunk->position_base;
+    size_t texcoords = chunk->texcoord_base;
+
+    for (const char* line = chunk->begin; line < chunk->end && chunk->error == NULL;)
+    {
+        const char* newline = memchr(line, '\n', chunk->end - line);
+        const char* end = newline ? newline : chunk->end;
+        const char* p = obj_skip_blanks(line, end);
+
+        bool ok = true;
+        switch (obj_line_kind(p, end))
+        {
+            case OBJ_LINE_POSITION:
+            {
+                // x y z [w] or x y z r g b
+                float values[7];
+                int count = obj_parse_floats(p + 1, end, values, 7);
+                float* position = import->positions + positions++ * OBJ_POSITION_FLOATS;
+                memcpy(position, values, sizeof(float) * 3);
+                if (count >= 6)
+                    memcpy(position + 3, values + 3, sizeof(float) * 3);
+                else
+                    position[3] = position[4] = position[5] = 1.0f;
+                ok = count >= 3;
+                break;
+            }
+            case OBJ_LINE_TEXCOORD:
+            {
+                float values[3] = { 0 };
+                int count = obj_parse_floats(p + 2, end, values, 3);
+                memcpy(import->texcoords + texcoords++ * 2, values, sizeof(float) * 2);
+                ok = count >= 1;
+                break;
+            }
+            case OBJ_LINE_FACE:
+                ok = obj_parse_face(import, chunk, p + 1, end, positions, texcoords);
+                break;
+            default:
+                break;
+        }
+
+        if (!ok)
+            chunk->error = line;
+        line = newline ? newline + 1 : chunk->end;
+    }
+}
+
+static inline int obj_shard_of(const obj_import* import, uint32_t position)
+{
+    return (int) ((uint64_t) position * import->shard_count / import->position_count);
+}
+
+static inline size_t obj_shard_slot(const obj_shard* shard, uint64_t key)
+{
+    return (size_t) ((key * 0x9e3779b97f4a7c15ull) >> 32) & (shard->capacity - 1);
+}
+
+static void obj_shard_grow(obj_shard* shard)
+{
+    uint64_t* keys = shard->keys;
+    uint32_t* ids = shard->ids;
+    size_t capacity = shard->capacity;
+
+    shard->capacity = capacity ? capacity * 2 : 4096;
+    shard->keys = calloc(shard->capacity, sizeof(uint64_t));
+    shard->ids = malloc(sizeof(uint32_t) * shard->capacity);
+    my_assert(shard->keys && shard->ids, "failed to grow obj vertex table");
+
+    for (size_t i = 0; i < capacity; i++)
+    {
+        if (keys[i] == 0)
+            continue;
+        size_t slot = obj_shard_slot(shard, keys[i]);
+        while (shard->keys[slot] != 0)
+            slot = (slot + 1) & (shard->capacity - 1);
+        shard->keys[slot] = keys[i];
+        shard->ids[slot] = ids[i];
+    }
+    free(keys);
+    free(ids);
+}
+
+static uint32_t obj_shard_insert(obj_shard* shard, obj_corner corner)
+{
+    // both halves are offset by one so no corner maps to the empty key, a missing texcoord wraps to 0
+    uint64_t key = ((uint64_t) corner.position + 1) << 32 | (uint32_t) (corner.texcoord + 1);
+
+    if ((shard->count + 1) * 2 > shard->capacity)
+        obj_shard_grow(shard);
+
+    size_t slot = obj_shard_slot(shard, key);
+    for (; shard->keys[slot] != 0; slot = (slot + 1) & (shard->capacity - 1))
+        if (shard->keys[slot] == key)
+            return shard->ids[slot];
+
+    if (shard->count == shard->unique_capacity)
+    {
+        shard->unique_capacity = shard->unique_capacity ? shard->unique_capacity * 2 : 4096;
+        shard->unique = realloc(shard->unique, sizeof(obj_corner) * shard->unique_capacity);
+        my_assert(shard->unique, "failed to grow obj vertices");
+    }
+    shard->keys[slot] = key;
+    shard->ids[slot] = (uint32_t) shard->count;
+    shard->unique[shard->count] = corner;
+    return (uint32_t) shard->count++;
+}
+
+/**
+ * shards own disjoint position ranges, so every shard scans all corners but touches only its own,
+ * the index of a corner is its id within the shard until the shard offsets are known
+ */
+static void obj_dedup_job(void* arg)
+{
+    obj_job* job = arg;
+    obj_import* import = job->import;
+    obj_shard* shard = &import->shards[job->index];
+
+    for (int c = 0; c < import->chunk_count; c++)
+    {
+        const obj_chunk* chunk = &import->chunks[c];
+        uint32_t* indices = import->mesh->indices + chunk->corner_base;
+        for (size_t i = 0; i < chunk->corner_count; i++)
+        {
+            uint32_t position = chunk->corners[i].position;
+            if (position >= shard->first_position && position < shard->end_position)
+                indices[i] = obj_shard_insert(shard, chunk->corners[i]);
+        }
+    }
+
+    free(shard->keys);
+    free(shard->ids);
+    shard->keys = NULL;
+    shard->ids = NULL;
+}
+
+static void obj_index_job(void* arg)
+{
+    obj_job* job = arg;
+    obj_import* import = job->import;
+    const obj_chunk* chunk = &import->chunks[job->index];
+
+    uint32_t* indices = import->mesh->indices + chunk->corner_base;
+    for (size_t i = 0; i < chunk->corner_count; i++)
+        indices[i] += (uint32_t) import->shards[obj_shard_of(import, chunk->corners[i].position)].vertex_base;
+}
+
+static void obj_vertex_job(void* arg)
+{
+    obj_job* job = arg;
+    obj_import* import = job->import;
+    const obj_shard* shard = &import->shards[job->index];
+
+    float* vertex = import->mesh->vertices + shard->vertex_base * OBJ_VERTEX_FLOATS;
+    for (size_t i = 0; i < shard->count; i++, vertex += OBJ_VERTEX_FLOATS)
+    {
+        obj_corner corner = shard->unique[i];
+        memcpy(vertex, import->positions + (size_t) corner.position * OBJ_POSITION_FLOATS, sizeof(float) * OBJ_POSITION_FLOATS);
+        if (corner.texcoord == OBJ_NO_TEXCOORD)
+            vertex[6] = vertex[7] = 0.0f;
+        else
+            memcpy(vertex + 6, import->texcoords + (size_t) corner.texcoord * 2, sizeof(float) * 2);
+    }
+}
+#pragma endregion
+
+static void obj_run(thread_pool_t* pool, thread_pool_job_fn fn, obj_job* jobs, int count)
+{
+    for (int i = 0; i < count; i++)
+        thread_pool_submit(pool, fn, &jobs[i]);
+    thread_pool_wait(pool);
+}
+
+static bool obj_import_run(obj_import* import, thread_pool_t* pool, const char* path, const char* base)
+{
+    obj_mesh* mesh = import->mesh;
+    int job_count = import->chunk_count > import->shard_count ? import->chunk_count : import->shard_count;
+    obj_job* jobs = malloc(sizeof(obj_job) * job_count);
+    my_assert(jobs, "failed to allocate obj jobs");
+    for (int i = 0; i < job_count; i++)
+        jobs[i] = (obj_job) { import, i };
+
+    obj_run(pool, obj_count_job, jobs, import->chunk_count);
+    for (int i = 0; i < import->chunk_count; i++)
+    {
+        obj_chunk* chunk = &import->chunks[i];
+        chunk->position_base = import->position_count;
+        chunk->texcoord_base = import->texcoord_count;
+        import->position_count += chunk->position_count;
+        import->texcoord_count += chunk->texcoord_count;
+    }
+
+    import->positions = malloc(sizeof(float) * OBJ_POSITION_FLOATS * (import->position_count + 1));
+    import->texcoords = malloc(sizeof(float) * 2 * (import->texcoord_count + 1));
+    my_assert(import->positions && import->texcoords, "failed to allocate obj attributes");
+
+    obj_run(pool, obj_parse_job, jobs, import->chunk_count);
+    for (int i = 0; i < import->chunk_count; i++)
+    {
+        obj_chunk* chunk = &import->chunks[i];
+        if (chunk->error)
+        {
+            size_t line = 1;
+            for (const char* p = base; (p = memchr(p, '\n', chunk->error - p)) != NULL; p++)
+                line++;
+            my_log(ERRMSG("malformed obj: ") PATHMSG("%s:%zu\n"), path, line);
+            free(jobs);
+            return false;
+        }
+        chunk->corner_base = mesh->index_count;
+        mesh->index_count += chunk->corner_count;
+    }
+    if (mesh->index_count == 0)
+    {
+        my_log(ERRMSG("obj has no faces: ") PATHMSG("%s\n"), path);
+        free(jobs);
+        return false;
+    }
+
+    mesh->indices = malloc(sizeof(uint32_t) * mesh->index_count);
+    my_assert(mesh->indices, "failed to allocate obj indices");
+    // the same ranges obj_shard_of() maps to, first position p with p * shard_count / position_count == s
+    for (int i = 0; i < import->shard_count; i++)
+    {
+        import->shards[i].first_position = (uint32_t) (((uint64_t) i * import->position_count + import->shard_count - 1) / import->shard_count);
+        import->shards[i].end_position = (uint32_t) (((uint64_t) (i + 1) * import->position_count + import->shard_count - 1) / import->shard_count);
+    }
+    obj_run(pool, obj_dedup_job, jobs, import->shard_count);
+
+    for (int i = 0; i < import->shard_count; i++)
+    {
+        import->shards[i].vertex_base = mesh->vertex_count;
+        mesh->vertex_count += import->shards[i].count;
+    }
+    if (mesh->vertex_count > UINT32_MAX)
+    {
+        my_log(ERRMSG("obj has too many vertices for 32-bit indices: ") PATHMSG("%s\n"), path);
+        free(jobs);
+        return false;
+    }
+
+    mesh->vertices = malloc(sizeof(float) * OBJ_VERTEX_FLOATS * mesh->vertex_count);
+    my_assert(mesh->vertices, "failed to allocate obj vertices");
+    for (int i = 0; i < import->chunk_count; i++)
+        thread_pool_submit(pool, obj_index_job, &jobs[i]);
+    for (int i = 0; i < import->shard_count; i++)
+        thread_pool_submit(pool, obj_vertex_job, &jobs[i]);
+    thread_pool_wait(pool);
+
+    free(jobs);
+    return true;
+}
+
+bool obj_load(const char* path, int thread_count, obj_mesh* mesh)
+{
+    memset(mesh, 0, sizeof(obj_mesh));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        my_log(ERRMSG("failed to open obj: ") PATHMSG("%s\n"), path);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        my_log(ERRMSG("obj has no faces: ") PATHMSG("%s\n"), path);
+        close(fd);
+        return false;
+    }
+
+    size_t size = st.st_size;
+    const char* base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        my_log(ERRMSG("failed to map obj: ") PATHMSG("%s\n"), path);
+        return false;
+    }
+    // chunks are read in parallel from several places, start reading all of it ahead
+    madvise((void*) base, size, MADV_WILLNEED);
+
+    thread_pool_t* pool = thread_pool_create(thread_count);
+    int threads = thread_pool_size(pool);
+
+    size_t chunk_size = size / ((size_t) threads * OBJ_CHUNKS_PER_THREAD) + 1;
+    if (chunk_size < OBJ_MIN_CHUNK_SIZE)
+        chunk_size = OBJ_MIN_CHUNK_SIZE;
+
+    obj_import import = {
+        .chunks = calloc(size / chunk_size + 1, sizeof(obj_chunk)),
+        .shards = calloc(threads, sizeof(obj_shard)),
+        .shard_count = threads,
+        .mesh = mesh
+    };
+    my_assert(import.chunks && import.shards, "failed to allocate obj import");
+
+    for (const char* p = base; p < base + size;)
+    {
+        const char* cut = (size_t) (base + size - p) > chunk_size ? p + chunk_size : base + size;
+        const char* newline = memchr(cut, '\n', base + size - cut);
+        cut = newline ? newline + 1 : base + size;
+
+        import.chunks[import.chunk_count++] = (obj_chunk) { .begin = p, .end = cut };
+        p = cut;
+    }
+
+    bool ok = obj_import_run(&import, pool, path, base);
+    thread_pool_destroy(pool);
+
+    for (int i = 0; i < import.chunk_count; i++)
+        free(import.chunks[i].corners);
+    for (int i = 0; i < import.shard_count; i++)
+        free(import.shards[i].unique);
+    free(import.chunks);
+    free(import.shards);
+    free(import.positions);
+    free(import.texcoords);
+    munmap((void*) base, size);
+
+    if (!ok)
+    {
+        obj_mesh_free(mesh);
+        return false;
+    }
+
+    my_log(INFOMSG("obj: %zu vertices, %zu triangles, %d workers: ") PATHMSG("%s\n"), mesh->vertex_count, mesh->index_count / 3, threads, path);
+    return true;
+}
+
+void obj_mesh_free(obj_mesh* mesh)
+{
+    free(mesh->vertices);
+    free(mesh->indices);
+    memset(mesh, 0, sizeof(obj_mesh));
+}
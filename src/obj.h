@@ -0,0 +1,32 @@
+#ifndef __OBJ_H__
+#define __OBJ_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// interleaved vertex of the VAO in main(): position xyz, color rgb, texture coords uv
+#define OBJ_VERTEX_FLOATS 8
+
+/**
+ * triangle mesh with one vertex per distinct position/texture coordinate pair
+ * colors come from the "v x y z r g b" extension, white without it, normals are ignored
+ */
+typedef struct obj_mesh
+{
+    float* vertices;  // vertex_count * OBJ_VERTEX_FLOATS
+    uint32_t* indices;
+    size_t vertex_count;
+    size_t index_count;
+} obj_mesh;
+
+/**
+ * maps a Wavefront OBJ file and parses it in chunks on thread_count workers (<= 0 uses one per core)
+ * polygons are triangulated as fans, both absolute and negative (relative) indices are supported
+ * returns false and logs the offending line when the file is missing or malformed
+ */
+bool obj_load(const char* path, int thread_count, obj_mesh* mesh);
+
+void obj_mesh_free(obj_mesh* mesh);
+
+#endif // __OBJ_H__
@@ -0,0 +1,139 @@
+#include "pbo_ring.h"
+
+#define ENABLE_LOGS
+#include "debug.h"
+
+typedef enum pbo_slot_state
+{
+    PBO_SLOT_FREE,
+    PBO_SLOT_MAPPED,    // handed out, CPU is writing
+    PBO_SLOT_IN_FLIGHT  // upload issued, fence pending
+} pbo_slot_state;
+
+typedef struct pbo_ring_slot
+{
+    GLuint buffer;
+    GLsync fence;
+    pbo_slot_state state;
+} pbo_ring_slot;
+
+struct pbo_ring
+{
+    pbo_ring_slot* slots;
+    int slot_count;
+    size_t slot_size;
+    // slots are handed out strictly in order
+    int next;
+};
+
+pbo_ring_t* pbo_ring_create(int slot_count, size_t slot_size)
+{
+    pbo_ring_t* ring = calloc(1, sizeof(pbo_ring_t));
+    my_assert(ring, "failed to allocate PBO ring");
+
+    ring->slots = calloc(slot_count, sizeof(pbo_ring_slot));
+    my_assert(ring->slots, "failed to allocate PBO ring slots");
+    ring->slot_count = slot_count;
+    ring->slot_size = slot_size;
+
+    for (int i = 0; i < slot_count; i++)
+    {
+        glGenBuffers(1, &ring->slots[i].buffer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring->slots[i].buffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, slot_size, NULL, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    gl_check_error();
+
+    return ring;
+}
+
+void pbo_ring_destroy(pbo_ring_t* ring)
+{
+    if (ring == NULL)
+        return;
+
+    for (int i = 0; i < ring->slot_count; i++)
+    {
+        pbo_ring_slot* slot = &ring->slots[i];
+        if (slot->state == PBO_SLOT_MAPPED)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot->buffer);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+        if (slot->fence)
+            glDeleteSync(slot->fence);
+        glDeleteBuffers(1, &slot->buffer);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    free(ring->slots);
+    free(ring);
+}
+
+size_t pbo_ring_slot_size(const pbo_ring_t* ring)
+{
+    return ring->slot_size;
+}
+
+bool pbo_ring_acquire(pbo_ring_t* ring, pbo_slot* slot, GLuint64 timeout_ns)
+{
+    pbo_ring_slot* next = &ring->slots[ring->next];
+
+    if (next->state == PBO_SLOT_MAPPED)
+        return false;
+
+    if (next->state == PBO_SLOT_IN_FLIGHT)
+    {
+        GLenum status = glClientWaitSync(next->fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout_ns);
+        if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED)
+            return false;
+
+        glDeleteSync(next->fence);
+        next->fence = NULL;
+        next->state = PBO_SLOT_FREE;
+    }
+
+    // GPU is done with the slot (fence above), no implicit sync needed
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, next->buffer);
+    void* ptr = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, ring->slot_size,
+                                 GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    gl_check_error();
+
+    if (ptr == NULL)
+        return false;
+
+    next->state = PBO_SLOT_MAPPED;
+    *slot = (pbo_slot) {
+        .index = ring->next,
+        .buffer = next->buffer,
+        .ptr = ptr,
+        .size = ring->slot_size
+    };
+    ring->next = (ring->next + 1) % ring->slot_count;
+
+    return true;
+}
+
+void pbo_ring_begin_upload(pbo_ring_t* ring, pbo_slot* slot)
+{
+    // the slot carries everything needed, ring keeps the call symmetric with pbo_ring_end_upload()
+    (void) ring;
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot->buffer);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    gl_check_error();
+
+    slot->ptr = NULL;
+}
+
+void pbo_ring_end_upload(pbo_ring_t* ring, pbo_slot* slot)
+{
+    pbo_ring_slot* ring_slot = &ring->slots[slot->index];
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    ring_slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    ring_slot->state = PBO_SLOT_IN_FLIGHT;
+    gl_check_error();
+}
@@ -0,0 +1,46 @@
+#ifndef __PBO_RING_H__
+#define __PBO_RING_H__
+
+#include <glad/glad.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// one GL_PIXEL_UNPACK_BUFFER of the ring, ptr is valid from acquire until upload
+typedef struct pbo_slot
+{
+    int index;
+    GLuint buffer;
+    void* ptr;
+    size_t size;
+} pbo_slot;
+
+typedef struct pbo_ring pbo_ring_t;
+
+/**
+ * allocates slot_count pixel unpack buffers of slot_size bytes each, GL thread only
+ */
+pbo_ring_t* pbo_ring_create(int slot_count, size_t slot_size);
+
+void pbo_ring_destroy(pbo_ring_t* ring);
+
+size_t pbo_ring_slot_size(const pbo_ring_t* ring);
+
+/**
+ * maps the next slot of the ring for writing, GL thread only
+ * waits up to timeout_ns for the GPU to finish reading the slot, returns false if it did not
+ * the mapped pointer may be written from any thread until pbo_ring_begin_upload()
+ */
+bool pbo_ring_acquire(pbo_ring_t* ring, pbo_slot* slot, GLuint64 timeout_ns);
+
+/**
+ * unmaps the slot and binds it to GL_PIXEL_UNPACK_BUFFER
+ * pixel pointers of following glTex*Image calls are byte offsets into the slot
+ */
+void pbo_ring_begin_upload(pbo_ring_t* ring, pbo_slot* slot);
+
+/**
+ * unbinds the slot and fences it so it is not reused before the GPU consumed it
+ */
+void pbo_ring_end_upload(pbo_ring_t* ring, pbo_slot* slot);
+
+#endif // __PBO_RING_H__
@@ -0,0 +1,311 @@
+#include "pixel.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PIXEL_X86
+#include <immintrin.h>
+#endif
+
+typedef void (*pixel_expand_fn)(const unsigned char* src, unsigned char* dst, size_t count);
+typedef void (*pixel_premultiply_fn)(unsigned char* pixels, size_t count);
+typedef void (*pixel_swizzle_fn)(unsigned char* pixels, size_t count, const unsigned char order[4]);
+typedef void (*pixel_swap_fn)(unsigned char* a, unsigned char* b, size_t size);
+
+static struct
+{
+    pthread_once_t once;
+    pixel_expand_fn expand_rgb_rgba;
+    pixel_premultiply_fn premultiply_rgba;
+    pixel_swizzle_fn swizzle_rgba;
+    pixel_swap_fn swap_rows;
+} pixel = { .once = PTHREAD_ONCE_INIT };
+
+#pragma region scalar
+static void pixel_expand_rgb_rgba_scalar(const unsigned char* src, unsigned char* dst, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        dst[i * 4 + 0] = src[i * 3 + 0];
+        dst[i * 4 + 1] = src[i * 3 + 1];
+        dst[i * 4 + 2] = src[i * 3 + 2];
+        dst[i * 4 + 3] = 255;
+    }
+}
+
+/**
+ * c * a / 255 rounded to nearest, exact for all 8-bit inputs
+ */
+static inline unsigned char pixel_mul_div255(unsigned int c, unsigned int a)
+{
+    unsigned int t = c * a + 128;
+    return (unsigned char) ((t + (t >> 8)) >> 8);
+}
+
+static void pixel_premultiply_rgba_scalar(unsigned char* pixels, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        unsigned char* p = pixels + i * 4;
+        p[0] = pixel_mul_div255(p[0], p[3]);
+        p[1] = pixel_mul_div255(p[1], p[3]);
+        p[2] = pixel_mul_div255(p[2], p[3]);
+    }
+}
+
+static void pixel_swizzle_rgba_scalar(unsigned char* pixels, size_t count, const unsigned char order[4])
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        unsigned char* p = pixels + i * 4;
+        unsigned char src[4] = { p[0], p[1], p[2], p[3] };
+        p[0] = src[order[0]];
+        p[1] = src[order[1]];
+        p[2] = src[order[2]];
+        p[3] = src[order[3]];
+    }
+}
+
+static void pixel_swap_rows_scalar(unsigned char* a, unsigned char* b, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        unsigned char t = a[i];
+        a[i] = b[i];
+        b[i] = t;
+    }
+}
+#pragma endregion
+
+#ifdef PIXEL_X86
+#pragma region SSE2
+/**
+ * 4 RGBA pixels per iteration, 16-bit lanes with alpha broadcast over its pixel
+ */
+static void pixel_premultiply_rgba_sse2(unsigned char* pixels, size_t count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi16(128);
+    // alpha lanes are multiplied by 255 and come out unchanged
+    const __m128i alpha_mask = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+    const __m128i alpha_one = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i p = _mm_loadu_si128((const __m128i*) (pixels + i * 4));
+        __m128i halves[2] = { _mm_unpacklo_epi8(p, zero), _mm_unpackhi_epi8(p, zero) };
+
+        for (int h = 0; h < 2; h++)
+        {
+            __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(halves[h], _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+            a = _mm_or_si128(_mm_andnot_si128(alpha_mask, a), alpha_one);
+
+            __m128i t = _mm_add_epi16(_mm_mullo_epi16(halves[h], a), round);
+            halves[h] = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+        }
+
+        _mm_storeu_si128((__m128i*) (pixels + i * 4), _mm_packus_epi16(halves[0], halves[1]));
+    }
+
+    pixel_premultiply_rgba_scalar(pixels + i * 4, count - i);
+}
+
+static void pixel_swap_rows_sse2(unsigned char* a, unsigned char* b, size_t size)
+{
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i va = _mm_loadu_si128((const __m128i*) (a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i*) (b + i));
+        _mm_storeu_si128((__m128i*) (a + i), vb);
+        _mm_storeu_si128((__m128i*) (b + i), va);
+    }
+
+    pixel_swap_rows_scalar(a + i, b + i, size - i);
+}
+#pragma endregion
+
+#pragma region SSSE3
+/**
+ * 4 pixels per iteration, each load reads 16 bytes of which 12 are used
+ */
+__attribute__((target("ssse3")))
+static void pixel_expand_rgb_rgba_ssse3(const unsigned char* src, unsigned char* dst, size_t count)
+{
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alpha = _mm_set1_epi32((int) 0xff000000);
+    size_t i = 0;
+
+    // the over-read of the last load must stay inside src
+    for (; i + 6 <= count; i += 4)
+    {
+        __m128i p = _mm_loadu_si128((const __m128i*) (src + i * 3));
+        _mm_storeu_si128((__m128i*) (dst + i * 4), _mm_or_si128(_mm_shuffle_epi8(p, shuffle), alpha));
+    }
+
+    pixel_expand_rgb_rgba_scalar(src + i * 3, dst + i * 4, count - i);
+}
+
+__attribute__((target("ssse3")))
+static void pixel_swizzle_rgba_ssse3(unsigned char* pixels, size_t count, const unsigned char order[4])
+{
+    unsigned char mask[16];
+    for (int i = 0; i < 16; i++)
+        mask[i] = (unsigned char) ((i & ~3) + order[i & 3]);
+    const __m128i shuffle = _mm_loadu_si128((const __m128i*) mask);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i p = _mm_loadu_si128((const __m128i*) (pixels + i * 4));
+        _mm_storeu_si128((__m128i*) (pixels + i * 4), _mm_shuffle_epi8(p, shuffle));
+    }
+
+    pixel_swizzle_rgba_scalar(pixels + i * 4, count - i, order);
+}
+#pragma endregion
+
+#pragma region AVX2
+/**
+ * 8 pixels per iteration, 12 source bytes go into each 128-bit lane
+ */
+__attribute__((target("avx2")))
+static void pixel_expand_rgb_rgba_avx2(const unsigned char* src, unsigned char* dst, size_t count)
+{
+    const __m256i shuffle = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                             0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m256i alpha = _mm256_set1_epi32((int) 0xff000000);
+    size_t i = 0;
+
+    // second lane loads 16 bytes from pixel i + 4
+    for (; i + 10 <= count; i += 8)
+    {
+        __m128i lo = _mm_loadu_si128((const __m128i*) (src + i * 3));
+        __m128i hi = _mm_loadu_si128((const __m128i*) (src + i * 3 + 12));
+        __m256i p = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        _mm256_storeu_si256((__m256i*) (dst + i * 4), _mm256_or_si256(_mm256_shuffle_epi8(p, shuffle), alpha));
+    }
+
+    pixel_expand_rgb_rgba_scalar(src + i * 3, dst + i * 4, count - i);
+}
+
+__attribute__((target("avx2")))
+static void pixel_premultiply_rgba_avx2(unsigned char* pixels, size_t count)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i round = _mm256_set1_epi16(128);
+    // replicates the alpha byte of each pixel into its 16-bit lanes, alpha lane itself gets 255
+    const __m256i alpha_shuffle = _mm256_setr_epi8(6, -1, 6, -1, 6, -1, -1, -1, 14, -1, 14, -1, 14, -1, -1, -1,
+                                                   6, -1, 6, -1, 6, -1, -1, -1, 14, -1, 14, -1, 14, -1, -1, -1);
+    const __m256i alpha_one = _mm256_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i p = _mm256_loadu_si256((const __m256i*) (pixels + i * 4));
+        __m256i halves[2] = { _mm256_unpacklo_epi8(p, zero), _mm256_unpackhi_epi8(p, zero) };
+
+        for (int h = 0; h < 2; h++)
+        {
+            __m256i a = _mm256_or_si256(_mm256_shuffle_epi8(halves[h], alpha_shuffle), alpha_one);
+            __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(halves[h], a), round);
+            halves[h] = _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+        }
+
+        // unpack and pack both work per lane, so the pixel order survives
+        _mm256_storeu_si256((__m256i*) (pixels + i * 4), _mm256_packus_epi16(halves[0], halves[1]));
+    }
+
+    pixel_premultiply_rgba_sse2(pixels + i * 4, count - i);
+}
+
+__attribute__((target("avx2")))
+static void pixel_swizzle_rgba_avx2(unsigned char* pixels, size_t count, const unsigned char order[4])
+{
+    unsigned char mask[32];
+    for (int i = 0; i < 32; i++)
+        mask[i] = (unsigned char) ((i & 12) + order[i & 3]);
+    const __m256i shuffle = _mm256_loadu_si256((const __m256i*) mask);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i p = _mm256_loadu_si256((const __m256i*) (pixels + i * 4));
+        _mm256_storeu_si256((__m256i*) (pixels + i * 4), _mm256_shuffle_epi8(p, shuffle));
+    }
+
+    pixel_swizzle_rgba_ssse3(pixels + i * 4, count - i, order);
+}
+
+__attribute__((target("avx2")))
+static void pixel_swap_rows_avx2(unsigned char* a, unsigned char* b, size_t size)
+{
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        __m256i va = _mm256_loadu_si256((const __m256i*) (a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i*) (b + i));
+        _mm256_storeu_si256((__m256i*) (a + i), vb);
+        _mm256_storeu_si256((__m256i*) (b + i), va);
+    }
+
+    pixel_swap_rows_sse2(a + i, b + i, size - i);
+}
+#pragma endregion
+#endif // PIXEL_X86
+
+static void pixel_init_once(void)
+{
+    pixel.expand_rgb_rgba = pixel_expand_rgb_rgba_scalar;
+    pixel.premultiply_rgba = pixel_premultiply_rgba_scalar;
+    pixel.swizzle_rgba = pixel_swizzle_rgba_scalar;
+    pixel.swap_rows = pixel_swap_rows_scalar;
+
+#ifdef PIXEL_X86
+    pixel.premultiply_rgba = pixel_premultiply_rgba_sse2;
+    pixel.swap_rows = pixel_swap_rows_sse2;
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("ssse3"))
+    {
+        pixel.expand_rgb_rgba = pixel_expand_rgb_rgba_ssse3;
+        pixel.swizzle_rgba = pixel_swizzle_rgba_ssse3;
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        pixel.expand_rgb_rgba = pixel_expand_rgb_rgba_avx2;
+        pixel.premultiply_rgba = pixel_premultiply_rgba_avx2;
+        pixel.swizzle_rgba = pixel_swizzle_rgba_avx2;
+        pixel.swap_rows = pixel_swap_rows_avx2;
+    }
+#endif
+}
+
+void pixel_expand_rgb_rgba(const unsigned char* src, unsigned char* dst, size_t count)
+{
+    pthread_once(&pixel.once, pixel_init_once);
+    pixel.expand_rgb_rgba(src, dst, count);
+}
+
+void pixel_premultiply_rgba(unsigned char* pixels, size_t count)
+{
+    pthread_once(&pixel.once, pixel_init_once);
+    pixel.premultiply_rgba(pixels, count);
+}
+
+void pixel_swizzle_rgba(unsigned char* pixels, size_t count, const unsigned char order[4])
+{
+    pthread_once(&pixel.once, pixel_init_once);
+    pixel.swizzle_rgba(pixels, count, order);
+}
+
+void pixel_flip_vertical(unsigned char* pixels, int width, int height, int bytes_per_pixel)
+{
+    pthread_once(&pixel.once, pixel_init_once);
+
+    size_t row_size = (size_t) width * bytes_per_pixel;
+    for (int y = 0; y < height / 2; y++)
+        pixel.swap_rows(pixels + y * row_size, pixels + (height - 1 - y) * row_size, row_size);
+}
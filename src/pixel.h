@@ -0,0 +1,33 @@
+#ifndef __PIXEL_H__
+#define __PIXEL_H__
+
+#include <stddef.h>
+
+/**
+ * load time pixel conversions, run on decode workers between stb_image and mip generation
+ * 8-bit channels only, kernels are picked at runtime (scalar, SSE2/SSSE3, AVX2)
+ */
+
+/**
+ * RGB -> RGBA with opaque alpha, src and dst must not overlap
+ */
+void pixel_expand_rgb_rgba(const unsigned char* src, unsigned char* dst, size_t count);
+
+/**
+ * multiplies color channels of RGBA pixels by their alpha, in place
+ * done on encoded values, so sRGB images get the same premultiplication the blender sees
+ */
+void pixel_premultiply_rgba(unsigned char* pixels, size_t count);
+
+/**
+ * reorders channels of RGBA pixels in place, channel i of the result is channel order[i] of the source
+ * e.g. {2, 1, 0, 3} turns BGRA into RGBA
+ */
+void pixel_swizzle_rgba(unsigned char* pixels, size_t count, const unsigned char order[4]);
+
+/**
+ * swaps rows top to bottom in place, rows are tightly packed
+ */
+void pixel_flip_vertical(unsigned char* pixels, int width, int height, int bytes_per_pixel);
+
+#endif // __PIXEL_H__
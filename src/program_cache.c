@@ -0,0 +1,157 @@
+#include "program_cache.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "gl_ext.h"
+#include "utils.h"
+
+#define ENABLE_LOGS
+#include "debug.h"
+
+#define PROGRAM_CACHE_MAGIC   0x31435250u // "PRC1"
+#define PROGRAM_CACHE_VERSION 1u
+
+typedef struct program_cache_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t format;  // binary format reported by glGetProgramBinary
+    uint32_t length;
+} program_cache_header;
+
+static void program_cache_path(uint64_t key, char* out, size_t out_size)
+{
+    snprintf(out, out_size, PROGRAM_CACHE_DIR "/%016llx.bin", (unsigned long long) key);
+}
+
+uint64_t program_cache_key(const char* const* sources, int count, const char* defines)
+{
+    const char* driver[] = {
+        (const char*) glGetString(GL_VENDOR),
+        (const char*) glGetString(GL_RENDERER),
+        (const char*) glGetString(GL_VERSION)
+    };
+
+    // terminators included so moving text between neighbours changes the key
+    uint64_t hash = HASH_FNV1A_SEED;
+    for (int i = 0; i < 3; i++)
+        if (driver[i])
+            hash = hash_fnv1a(driver[i], strlen(driver[i]) + 1, hash);
+    if (defines)
+        hash = hash_fnv1a(defines, strlen(defines) + 1, hash);
+    for (int i = 0; i < count; i++)
+        hash = hash_fnv1a(sources[i], strlen(sources[i]) + 1, hash);
+    return hash;
+}
+
+bool program_cache_load(uint64_t key, GLuint program)
+{
+    if (gl_ext.program_binary == NULL)
+        return false;
+
+    char path[256];
+    program_cache_path(key, path, sizeof(path));
+
+    FILE* f = fopen(path, "rb");
+    if (f == NULL)
+        return false;
+
+    program_cache_header header;
+    void* binary = NULL;
+    bool ok = fread(&header, sizeof(header), 1, f) == 1
+           && header.magic == PROGRAM_CACHE_MAGIC
+           && header.version == PROGRAM_CACHE_VERSION
+           && header.key == key
+           && header.length > 0
+           && (binary = malloc(header.length)) != NULL
+           && fread(binary, 1, header.length, f) == header.length;
+    fclose(f);
+
+    if (ok)
+    {
+        gl_ext.program_binary(program, header.format, binary, header.length);
+
+        // drivers reject binaries of other builds through the link status, not an error
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        ok = linked == GL_TRUE;
+    }
+    // clear GL_INVALID_ENUM of a format this driver no longer knows
+    while (glGetError() != GL_NO_ERROR);
+
+    free(binary);
+    return ok;
+}
+
+bool program_cache_store(uint64_t key, GLuint program)
+{
+    if (gl_ext.get_program_binary == NULL)
+        return false;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return false;
+
+    void* binary = malloc(length);
+    my_assert(binary, "failed to allocate program binary");
+
+    GLenum format = 0;
+    GLsizei written = 0;
+    gl_ext.get_program_binary(program, length, &written, &format, binary);
+    gl_check_error();
+
+    if (mkdir(PROGRAM_CACHE_DIR, 0755) != 0 && errno != EEXIST)
+    {
+        free(binary);
+        return false;
+    }
+
+    char path[256];
+    char tmp_path[272];
+    program_cache_path(key, path, sizeof(path));
+    snprintf(tmp_path, sizeof(tmp_path), "%s.XXXXXX", path);
+
+    // written aside and renamed, a crash never leaves a truncated binary behind
+    int fd = mkstemp(tmp_path);
+    FILE* f = fd >= 0 ? fdopen(fd, "wb") : NULL;
+    if (f == NULL)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+            unlink(tmp_path);
+        }
+        free(binary);
+        return false;
+    }
+
+    program_cache_header header = {
+        .magic = PROGRAM_CACHE_MAGIC,
+        .version = PROGRAM_CACHE_VERSION,
+        .key = key,
+        .format = format,
+        .length = (uint32_t) written
+    };
+
+    bool ok = written > 0
+           && fwrite(&header, sizeof(header), 1, f) == 1
+           && fwrite(binary, 1, written, f) == (size_t) written;
+    ok = fclose(f) == 0 && ok;
+    if (ok)
+        ok = rename(tmp_path, path) == 0;
+
+    if (!ok)
+    {
+        unlink(tmp_path);
+        my_log(WARRMSG("failed to write program cache: ") PATHMSG("%s\n"), path);
+    }
+
+    free(binary);
+    return ok;
+}
@@ -0,0 +1,28 @@
+#ifndef __PROGRAM_CACHE_H__
+#define __PROGRAM_CACHE_H__
+
+#include <glad/glad.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// linked program binaries, one file per key: ./shader_cache/<key>.bin
+#define PROGRAM_CACHE_DIR "./shader_cache"
+
+/**
+ * key of a program built from sources with given defines (may be NULL) on the current driver
+ * vendor, renderer and version strings are part of it, a driver update never loads a stale binary
+ */
+uint64_t program_cache_key(const char* const* sources, int count, const char* defines);
+
+/**
+ * loads cached binary into program with glProgramBinary
+ * returns false when there is no entry or the driver rejects it, the program must then be linked from source
+ */
+bool program_cache_load(uint64_t key, GLuint program);
+
+/**
+ * saves binary of a linked program, it should be linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+ */
+bool program_cache_store(uint64_t key, GLuint program);
+
+#endif // __PROGRAM_CACHE_H__
@@ -0,0 +1,386 @@
+#include "shader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gl_ext.h"
+#include "program_cache.h"
+#include "shader_preprocessor.h"
+#include "shader_reflection.h"
+#include "shader_spirv.h"
+#include "shader_stats.h"
+
+#define ENABLE_LOGS
+#include "debug.h"
+
+/**
+ * compiles source, name only labels the error log
+ */
+static bool shader_compile(unsigned int* shader_obj, GLenum shader_type, const char* source, const char* name)
+{
+    *shader_obj = glCreateShader(shader_type);
+
+    glShaderSource(*shader_obj, 1, (const GLchar * const*) &source, NULL);
+    gl_check_error();
+
+    glCompileShader(*shader_obj);
+    gl_check_error();
+
+    int success;
+    char info_log[SHADER_ERROR_LOG_SIZE];
+    glGetShaderiv(*shader_obj, GL_COMPILE_STATUS, &success);
+    gl_check_error();
+
+    if (!success)
+    {
+        glGetShaderInfoLog(*shader_obj, SHADER_ERROR_LOG_SIZE, NULL, info_log);
+        my_log(ERRMSG("failed to compile SHADER: ") PATHMSG("%s") "\nerror messages:\n%s\n", name, info_log);
+        glDeleteShader(*shader_obj);
+        *shader_obj = 0;
+        return false;
+    }
+
+    return true;
+}
+
+bool create_shader(unsigned int* shader_obj, GLenum shader_type, const char* path)
+{
+    char* shader_src = shader_preprocess(path, NULL, NULL);
+    if (shader_src == NULL)
+        return false;
+
+    bool ok = shader_compile(shader_obj, shader_type, shader_src, path);
+    free(shader_src);
+    return ok;
+}
+
+// Error checking
+bool check_program_linking(unsigned int shader_program)
+{
+    int success;
+    char info_log[SHADER_ERROR_LOG_SIZE];
+    glGetProgramiv(shader_program, GL_LINK_STATUS, &success);
+    gl_check_error();
+
+    if (!success)
+    {
+        glGetProgramInfoLog(shader_program, SHADER_ERROR_LOG_SIZE, NULL, info_log);
+        my_log(ERRMSG("failed to link SHADERS in program") "\nerror messages:\n%s\n", info_log);
+    }
+
+    return success;
+}
+
+#pragma region batch
+typedef struct shader_build
+{
+    char* paths[2];
+    char* defines;
+    char* sources[2];
+    shader_source_files files[2];  // index of a file is its source string number in compile logs
+    GLuint shaders[2];
+    GLuint program;
+    uint64_t key;
+    shader_build_state state;
+    bool spirv;        // stages come from precompiled modules
+    bool spirv_failed; // modules were rejected, rebuilt from GLSL
+    double submitted;  // shader_stats_now() at submit
+    shader_stat stat;
+} shader_build;
+
+struct shader_batch
+{
+    shader_build* builds;
+    int count;
+    int capacity;
+};
+
+static const GLenum shader_stages[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+
+shader_batch_t* shader_batch_create(void)
+{
+    shader_batch_t* batch = calloc(1, sizeof(shader_batch_t));
+    my_assert(batch, "failed to allocate shader batch");
+    return batch;
+}
+
+static void shader_build_release_sources(shader_build* build)
+{
+    for (int stage = 0; stage < 2; stage++)
+    {
+        if (build->shaders[stage])
+        {
+            if (build->program)
+                glDetachShader(build->program, build->shaders[stage]);
+            glDeleteShader(build->shaders[stage]);
+            build->shaders[stage] = 0;
+        }
+        free(build->sources[stage]);
+        build->sources[stage] = NULL;
+        shader_source_files_free(&build->files[stage]);
+    }
+}
+
+static void shader_build_fail(shader_build* build)
+{
+    shader_build_release_sources(build);
+    if (build->program)
+        glDeleteProgram(build->program);
+    build->program = 0;
+    build->state = SHADER_BUILD_FAILED;
+}
+
+/**
+ * records stat of a build that just became ready or failed
+ */
+static void shader_build_record(shader_build* build)
+{
+    build->stat.key = build->key;
+    build->stat.failed = build->state == SHADER_BUILD_FAILED;
+    build->stat.total_ms = shader_stats_now() - build->submitted;
+    shader_stats_record(&build->stat);
+}
+
+void shader_batch_destroy(shader_batch_t* batch)
+{
+    if (batch == NULL)
+        return;
+
+    for (int i = 0; i < batch->count; i++)
+    {
+        shader_build* build = &batch->builds[i];
+        if (build->state == SHADER_BUILD_COMPILING)
+            shader_build_fail(build);
+        shader_build_release_sources(build);
+        free(build->paths[0]);
+        free(build->paths[1]);
+        free(build->defines);
+    }
+    free(batch->builds);
+    free(batch);
+}
+
+int shader_batch_add(shader_batch_t* batch, const char* vertex_path, const char* fragment_path, const char* defines)
+{
+    if (batch->count == batch->capacity)
+    {
+        batch->capacity = batch->capacity ? batch->capacity * 2 : 8;
+        batch->builds = realloc(batch->builds, sizeof(shader_build) * batch->capacity);
+        my_assert(batch->builds, "failed to grow shader batch");
+    }
+
+    batch->builds[batch->count] = (shader_build) {
+        .paths = { strdup(vertex_path), strdup(fragment_path) },
+        .defines = defines ? strdup(defines) : NULL,
+        .state = SHADER_BUILD_QUEUED
+    };
+    return batch->count++;
+}
+
+/**
+ * issues compiles of both stages, from SPIR-V modules when there are any for these sources
+ */
+static void shader_build_compile(shader_build* build)
+{
+    double compile_start = shader_stats_now();
+    for (int stage = 0; stage < 2; stage++)
+        build->shaders[stage] = glCreateShader(shader_stages[stage]);
+
+    build->spirv = !build->spirv_failed && shader_spirv_load(build->shaders, build->sources, 2);
+    if (!build->spirv)
+    {
+        for (int stage = 0; stage < 2; stage++)
+        {
+            glShaderSource(build->shaders[stage], 1, (const GLchar * const*) &build->sources[stage], NULL);
+            glCompileShader(build->shaders[stage]);
+        }
+    }
+
+    build->stat.spirv = build->spirv;
+    build->stat.compile_ms += shader_stats_now() - compile_start;
+    build->state = SHADER_BUILD_COMPILING;
+}
+
+static void shader_build_link(shader_build* build)
+{
+    // Attach shader stages
+    glAttachShader(build->program, build->shaders[0]);
+    glAttachShader(build->program, build->shaders[1]);
+
+    // keeps the driver's binary around for program_cache_store()
+    if (gl_ext.program_parameteri)
+        gl_ext.program_parameteri(build->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+    // link shader stages
+    double link_start = shader_stats_now();
+    glLinkProgram(build->program);
+    build->stat.link_ms += shader_stats_now() - link_start;
+}
+
+void shader_batch_submit(shader_batch_t* batch)
+{
+    // compiles of all programs first, nothing below waits for the driver
+    for (int i = 0; i < batch->count; i++)
+    {
+        shader_build* build = &batch->builds[i];
+        if (build->state != SHADER_BUILD_QUEUED)
+            continue;
+
+        build->submitted = shader_stats_now();
+        shader_stat_init(&build->stat, build->paths[0], build->paths[1], build->defines);
+
+        build->sources[0] = shader_preprocess(build->paths[0], build->defines, &build->files[0]);
+        build->sources[1] = shader_preprocess(build->paths[1], build->defines, &build->files[1]);
+        double preprocessed = shader_stats_now();
+        build->stat.preprocess_ms = preprocessed - build->submitted;
+        if (build->sources[0] == NULL || build->sources[1] == NULL)
+        {
+            shader_build_fail(build);
+            shader_build_record(build);
+            continue;
+        }
+        build->stat.source_bytes = strlen(build->sources[0]) + strlen(build->sources[1]);
+
+        build->program = glCreateProgram();
+        build->key = program_cache_key((const char* const*) build->sources, 2, build->defines);
+        build->stat.cache_hit = program_cache_load(build->key, build->program);
+        if (build->stat.cache_hit)
+        {
+            build->stat.compile_ms = shader_stats_now() - preprocessed;
+            shader_build_release_sources(build);
+            shader_reflect(build->program);
+            build->state = SHADER_BUILD_READY;
+            shader_build_record(build);
+            continue;
+        }
+
+        shader_build_compile(build);
+    }
+    gl_check_error();
+
+    // then links, a stage that failed to compile makes its link fail, reported in shader_build_finish()
+    for (int i = 0; i < batch->count; i++)
+        if (batch->builds[i].state == SHADER_BUILD_COMPILING)
+            shader_build_link(&batch->builds[i]);
+    gl_check_error();
+}
+
+/**
+ * first status query of the build, blocks unless the driver reported completion
+ */
+static void shader_build_finish(shader_build* build)
+{
+    // without parallel compile the driver does the actual work here
+    double status_start = shader_stats_now();
+    GLint linked = GL_FALSE;
+    glGetProgramiv(build->program, GL_LINK_STATUS, &linked);
+    build->stat.link_ms += shader_stats_now() - status_start;
+
+    // a module built for another driver or from a broken toolchain, the GLSL text is still there
+    if (!linked && build->spirv)
+    {
+        my_log(WARRMSG("SPIR-V program rejected, compiling GLSL: ") PATHMSG("%s %s\n"), build->paths[0], build->paths[1]);
+        for (int stage = 0; stage < 2; stage++)
+        {
+            glDetachShader(build->program, build->shaders[stage]);
+            glDeleteShader(build->shaders[stage]);
+        }
+        build->spirv_failed = true;
+        shader_build_compile(build);
+        shader_build_link(build);
+        return;
+    }
+
+    if (!linked)
+    {
+        // compile logs say more than the link log when a stage is broken
+        bool compiled = true;
+        for (int stage = 0; stage < 2; stage++)
+        {
+            GLint success;
+            glGetShaderiv(build->shaders[stage], GL_COMPILE_STATUS, &success);
+            if (!success)
+            {
+                char info_log[SHADER_ERROR_LOG_SIZE];
+                glGetShaderInfoLog(build->shaders[stage], SHADER_ERROR_LOG_SIZE, NULL, info_log);
+                my_log(ERRMSG("failed to compile SHADER: ") PATHMSG("%s") "\nerror messages:\n%s\n", build->paths[stage], info_log);
+                for (int file = 1; file < build->files[stage].count; file++)
+                    my_log("source %d: " PATHMSG("%s\n"), file, build->files[stage].paths[file]);
+                compiled = false;
+            }
+        }
+        if (compiled)
+            check_program_linking(build->program);
+
+        shader_build_fail(build);
+        shader_build_record(build);
+        return;
+    }
+
+    // remove now uneneccesary shaders
+    shader_build_release_sources(build);
+    program_cache_store(build->key, build->program);
+    shader_reflect(build->program);
+    build->state = SHADER_BUILD_READY;
+    shader_build_record(build);
+}
+
+bool shader_batch_poll(shader_batch_t* batch)
+{
+    bool done = true;
+    for (int i = 0; i < batch->count; i++)
+    {
+        shader_build* build = &batch->builds[i];
+        if (build->state != SHADER_BUILD_COMPILING)
+            continue;
+
+        if (gl_ext.parallel_shader_compile)
+        {
+            GLint completed = GL_FALSE;
+            glGetProgramiv(build->program, GL_COMPLETION_STATUS_KHR, &completed);
+            if (!completed)
+            {
+                done = false;
+                continue;
+            }
+        }
+
+        // a rejected SPIR-V build is back to compiling GLSL
+        shader_build_finish(build);
+        done &= build->state != SHADER_BUILD_COMPILING;
+    }
+    return done;
+}
+
+void shader_batch_wait(shader_batch_t* batch)
+{
+    for (int i = 0; i < batch->count; i++)
+        while (batch->builds[i].state == SHADER_BUILD_COMPILING)
+            shader_build_finish(&batch->builds[i]);
+}
+
+shader_build_state shader_batch_state(const shader_batch_t* batch, int index)
+{
+    my_assert(index >= 0 && index < batch->count, "shader build index out of range");
+    return batch->builds[index].state;
+}
+
+GLuint shader_batch_program(const shader_batch_t* batch, int index)
+{
+    my_assert(index >= 0 && index < batch->count, "shader build index out of range");
+    return batch->builds[index].state == SHADER_BUILD_READY ? batch->builds[index].program : 0;
+}
+#pragma endregion
+
+GLuint shader_program_create(const char* vertex_path, const char* fragment_path)
+{
+    shader_batch_t* batch = shader_batch_create();
+    int index = shader_batch_add(batch, vertex_path, fragment_path, NULL);
+    shader_batch_submit(batch);
+    shader_batch_wait(batch);
+
+    GLuint program = shader_batch_program(batch, index);
+    shader_batch_destroy(batch);
+    return program;
+}
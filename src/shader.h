@@ -0,0 +1,82 @@
+#ifndef __SHADER_H__
+#define __SHADER_H__
+
+#include <glad/glad.h>
+#include <stdbool.h>
+
+#define SHADER_ERROR_LOG_SIZE 512
+
+/**
+ * preprocesses (see shader_preprocess()), compiles and checks for shader errors
+ */
+bool create_shader(unsigned int* shader_obj, GLenum shader_type, const char* path);
+
+/**
+ * logs the info log of a program that failed to link
+ */
+bool check_program_linking(unsigned int shader_program);
+
+/**
+ * builds vertex + fragment program, linked binaries are kept in the program cache
+ * a cached binary skips compile and link entirely, the sources are only read to compute its key
+ * blocks until linked, returns 0 when a stage fails to compile or the program fails to link
+ */
+GLuint shader_program_create(const char* vertex_path, const char* fragment_path);
+
+#pragma region batch
+/**
+ * builds many programs without a sync point per shader, every finished build is recorded in shader_stats.h
+ * submit issues every compile and link first, status is queried only afterwards,
+ * so the driver overlaps the work (on its own threads with KHR_parallel_shader_compile)
+ */
+typedef struct shader_batch shader_batch_t;
+
+typedef enum shader_build_state
+{
+    SHADER_BUILD_QUEUED,     // added, not submitted yet
+    SHADER_BUILD_COMPILING,  // compile and link issued to the driver
+    SHADER_BUILD_READY,      // linked, shader_batch_program() returns it
+    SHADER_BUILD_FAILED      // missing source, compile or link error (already logged)
+} shader_build_state;
+
+shader_batch_t* shader_batch_create(void);
+
+/**
+ * frees the batch, linked programs stay alive and belong to the caller, unfinished ones are deleted
+ */
+void shader_batch_destroy(shader_batch_t* batch);
+
+/**
+ * queues vertex + fragment program, defines (may be NULL) are injected into both stages
+ * returns its index in the batch
+ */
+int shader_batch_add(shader_batch_t* batch, const char* vertex_path, const char* fragment_path, const char* defines);
+
+/**
+ * preprocesses sources, resolves cache hits and issues compile + link of everything else
+ * stages are loaded from precompiled SPIR-V modules when the context supports them and modules
+ * for exactly these sources exist (see shader_spirv.h), a rejected module falls back to GLSL
+ */
+void shader_batch_submit(shader_batch_t* batch);
+
+/**
+ * finishes programs the driver is done with, never blocks when the context has parallel compile
+ * (without it the first query waits for the driver), returns true once no build is in flight
+ */
+bool shader_batch_poll(shader_batch_t* batch);
+
+/**
+ * blocks until every build is ready or failed
+ */
+void shader_batch_wait(shader_batch_t* batch);
+
+shader_build_state shader_batch_state(const shader_batch_t* batch, int index);
+
+/**
+ * linked program, 0 until the build is ready
+ * its reflection table is built already (see shader_reflection.h), delete it with shader_program_delete()
+ */
+GLuint shader_batch_program(const shader_batch_t* batch, int index);
+#pragma endregion
+
+#endif // __SHADER_H__
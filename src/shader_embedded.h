@@ -0,0 +1,19 @@
+#ifndef __SHADER_EMBEDDED_H__
+#define __SHADER_EMBEDDED_H__
+
+#include <stdint.h>
+
+// shader source compiled into the executable by tools/shader_embed.c
+typedef struct shader_embedded
+{
+    const char* path;  // relative to the project root, without leading "./"
+    const char* data;  // NUL terminated
+    uint32_t size;     // without the terminator
+    uint64_t hash;     // hash_fnv1a() of data
+} shader_embedded;
+
+// generated into src/shaders_embedded.c from shaders/* by the Makefile
+extern const shader_embedded shader_embedded_table[];
+extern const int shader_embedded_count;
+
+#endif // __SHADER_EMBEDDED_H__
@@ -0,0 +1,277 @@
+#include "shader_preprocessor.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "shader_embedded.h"
+
+#define ENABLE_LOGS
+#include "debug.h"
+
+static shader_source_mode source_mode = SHADER_SOURCE_EMBEDDED;
+
+typedef struct shader_text
+{
+    char* data;
+    size_t size;
+    size_t capacity;
+} shader_text;
+
+static void shader_text_append(shader_text* text, const char* str, size_t length)
+{
+    if (text->size + length + 1 > text->capacity)
+    {
+        while (text->size + length + 1 > text->capacity)
+            text->capacity = text->capacity ? text->capacity * 2 : 4096;
+        text->data = realloc(text->data, text->capacity);
+        my_assert(text->data, "failed to grow shader source");
+    }
+    memcpy(text->data + text->size, str, length);
+    text->size += length;
+    text->data[text->size] = '\0';
+}
+
+static void shader_text_line_directive(shader_text* text, int line, int file)
+{
+    char directive[48];
+    int length = snprintf(directive, sizeof(directive), "#line %d %d\n", line, file);
+    shader_text_append(text, directive, length);
+}
+
+void shader_preprocess_set_mode(shader_source_mode mode)
+{
+    source_mode = mode;
+}
+
+static const shader_embedded* shader_embedded_find(const char* path)
+{
+    while (strncmp(path, "./", 2) == 0)
+        path += 2;
+
+    for (int i = 0; i < shader_embedded_count; i++)
+        if (strcmp(shader_embedded_table[i].path, path) == 0)
+            return &shader_embedded_table[i];
+    return NULL;
+}
+
+static char* shader_read_file(const char* path)
+{
+    if (source_mode == SHADER_SOURCE_EMBEDDED)
+    {
+        const shader_embedded* embedded = shader_embedded_find(path);
+        if (embedded)
+        {
+            char* shader_src = malloc(embedded->size + 1);
+            my_assert(shader_src, "failed to allocate shader source");
+            memcpy(shader_src, embedded->data, embedded->size + 1);
+            return shader_src;
+        }
+    }
+
+    FILE* f_shader_src = fopen(path, "r");
+    if (f_shader_src == NULL)
+    {
+        my_log(ERRMSG("failed to open shader: ") PATHMSG("%s\n"), path);
+        return NULL;
+    }
+
+    fseek(f_shader_src, 0, SEEK_END);
+    long size = ftell(f_shader_src);
+    fseek(f_shader_src, 0, SEEK_SET);
+
+    char* shader_src = malloc(size + 1);
+    my_assert(shader_src, "failed to allocate shader source");
+    size_t read = fread(shader_src, 1, size, f_shader_src);
+    shader_src[read] = '\0';
+    fclose(f_shader_src);
+
+    return shader_src;
+}
+
+static int shader_source_files_add(shader_source_files* files, const char* path)
+{
+    if (files->count == files->capacity)
+    {
+        files->capacity = files->capacity ? files->capacity * 2 : 8;
+        files->paths = realloc(files->paths, sizeof(char*) * files->capacity);
+        my_assert(files->paths, "failed to grow shader file list");
+    }
+    files->paths[files->count] = strdup(path);
+    return files->count++;
+}
+
+static int shader_source_files_find(const shader_source_files* files, const char* path)
+{
+    for (int i = 0; i < files->count; i++)
+        if (strcmp(files->paths[i], path) == 0)
+            return i;
+    return -1;
+}
+
+void shader_source_files_free(shader_source_files* files)
+{
+    for (int i = 0; i < files->count; i++)
+        free(files->paths[i]);
+    free(files->paths);
+    *files = (shader_source_files) { 0 };
+}
+
+/**
+ * file name of #include "name" or #include <name>, NULL when the directive is malformed
+ */
+static char* shader_include_name(const char* directive, const char* line_end)
+{
+    const char* p = directive;
+    while (p < line_end && (*p == ' ' || *p == '\t'))
+        p++;
+
+    if (p >= line_end || (*p != '"' && *p != '<'))
+        return NULL;
+    char close = *p == '"' ? '"' : '>';
+
+    const char* start = ++p;
+    while (p < line_end && *p != close)
+        p++;
+    if (p >= line_end || p == start)
+        return NULL;
+
+    return strndup(start, p - start);
+}
+
+/**
+ * include path resolved against the directory of the including file
+ */
+static char* shader_include_path(const char* includer, const char* name)
+{
+    const char* slash = strrchr(includer, '/');
+    if (slash == NULL || name[0] == '/')
+        return strdup(name);
+
+    int dir_length = (int) (slash - includer);
+    size_t size = dir_length + strlen(name) + 2;
+    char* path = malloc(size);
+    my_assert(path, "failed to allocate include path");
+    snprintf(path, size, "%.*s/%s", dir_length, includer, name);
+    return path;
+}
+
+typedef struct shader_preprocessor
+{
+    shader_text text;
+    shader_source_files* files;
+    const char* defines;
+    bool version_found;
+} shader_preprocessor;
+
+static bool shader_preprocess_file(shader_preprocessor* pp, int file)
+{
+    const char* path = pp->files->paths[file];
+    char* source = shader_read_file(path);
+    if (source == NULL)
+        return false;
+
+    bool ok = true;
+    int line_number = 1;
+    for (const char* line = source; ok && *line != '\0'; line_number++)
+    {
+        const char* newline = strchr(line, '\n');
+        const char* line_end = newline ? newline : line + strlen(line);
+        const char* next = newline ? newline + 1 : line_end;
+
+        const char* p = line;
+        while (*p == ' ' || *p == '\t')
+            p++;
+        if (*p == '#')
+        {
+            p++;
+            while (*p == ' ' || *p == '\t')
+                p++;
+
+            if (strncmp(p, "include", 7) == 0)
+            {
+                char* name = shader_include_name(p + 7, line_end);
+                if (name == NULL)
+                {
+                    my_log(ERRMSG("malformed #include in shader: ") PATHMSG("%s:%d\n"), path, line_number);
+                    ok = false;
+                    break;
+                }
+
+                char* include_path = shader_include_path(path, name);
+                // included once per shader, this also breaks include cycles
+                if (shader_source_files_find(pp->files, include_path) < 0)
+                {
+                    int included = shader_source_files_add(pp->files, include_path);
+                    shader_text_line_directive(&pp->text, 1, included);
+                    ok = shader_preprocess_file(pp, included);
+                    my_log_if(!ok, ERRMSG("included from: ") PATHMSG("%s:%d\n"), path, line_number);
+                }
+                shader_text_line_directive(&pp->text, line_number + 1, file);
+
+                free(include_path);
+                free(name);
+                line = next;
+                continue;
+            }
+
+            // defines have to follow #version, nothing but comments may precede it
+            if (file == 0 && !pp->version_found && strncmp(p, "version", 7) == 0)
+            {
+                shader_text_append(&pp->text, line, line_end - line);
+                shader_text_append(&pp->text, "\n", 1);
+                if (pp->defines)
+                {
+                    shader_text_append(&pp->text, pp->defines, strlen(pp->defines));
+                    shader_text_line_directive(&pp->text, line_number + 1, file);
+                }
+                pp->version_found = true;
+                line = next;
+                continue;
+            }
+        }
+
+        shader_text_append(&pp->text, line, line_end - line);
+        shader_text_append(&pp->text, "\n", 1);
+        line = next;
+    }
+
+    free(source);
+    return ok;
+}
+
+char* shader_preprocess(const char* path, const char* defines, shader_source_files* files)
+{
+    shader_source_files local_files = { 0 };
+    shader_preprocessor pp = {
+        .files = files ? files : &local_files,
+        .defines = defines
+    };
+
+    my_assert(pp.files->count == 0, "shader file list has to start empty");
+    shader_source_files_add(pp.files, path);
+
+    bool ok = shader_preprocess_file(&pp, 0);
+    shader_source_files_free(&local_files);
+
+    if (!ok)
+    {
+        free(pp.text.data);
+        return NULL;
+    }
+
+    // without #version the defines simply go first
+    if (defines && !pp.version_found)
+    {
+        shader_text text = { 0 };
+        shader_text_append(&text, defines, strlen(defines));
+        shader_text_line_directive(&text, 1, 0);
+        shader_text_append(&text, pp.text.data ? pp.text.data : "", pp.text.size);
+        free(pp.text.data);
+        pp.text = text;
+    }
+
+    if (pp.text.data == NULL)
+        shader_text_append(&pp.text, "", 0);
+    return pp.text.data;
+}
@@ -0,0 +1,36 @@
+#ifndef __SHADER_PREPROCESSOR_H__
+#define __SHADER_PREPROCESSOR_H__
+
+#include <stdbool.h>
+
+// files a preprocessed source was assembled from, paths[0] is the shader itself
+typedef struct shader_source_files
+{
+    char** paths;
+    int count;
+    int capacity;
+} shader_source_files;
+
+typedef enum shader_source_mode
+{
+    SHADER_SOURCE_EMBEDDED,  // sources compiled into the executable, files missing there are read from disk
+    SHADER_SOURCE_DISK       // always read from disk, needed for hot reload
+} shader_source_mode;
+
+/**
+ * where shader_preprocess() reads files from, SHADER_SOURCE_EMBEDDED by default
+ */
+void shader_preprocess_set_mode(shader_source_mode mode);
+
+/**
+ * reads shader and resolves #include "file" relative to the including file, every file is included once
+ * defines (may be NULL) are injected right after #version, #line directives keep compile errors
+ * pointing at the right line, their source string number is the index into files
+ * files (may be NULL) receives every file read, also when preprocessing fails
+ * returns NULL when a file is missing, the result must be freed
+ */
+char* shader_preprocess(const char* path, const char* defines, shader_source_files* files);
+
+void shader_source_files_free(shader_source_files* files);
+
+#endif // __SHADER_PREPROCESSOR_H__
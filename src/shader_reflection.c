@@ -0,0 +1,240 @@
+#include "shader_reflection.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frame_uniforms.h"
+#include "gl_ext.h"
+#include "utils.h"
+
+#define ENABLE_LOGS
+#include "debug.h"
+
+static const char* shader_uniform_names[SHADER_UNIFORM_COUNT] = {
+    [SHADER_UNIFORM_MODEL]           = "model",
+    [SHADER_UNIFORM_VIEW]            = "view",
+    [SHADER_UNIFORM_PROJECTION]      = "projection",
+    [SHADER_UNIFORM_TEXTURE1]        = "texture1",
+    [SHADER_UNIFORM_MVP]             = "mvp",
+    [SHADER_UNIFORM_NORMAL_MATRIX]   = "normal_matrix",
+    [SHADER_UNIFORM_POSITION_SCALE]  = "position_scale",
+    [SHADER_UNIFORM_POSITION_OFFSET] = "position_offset"
+};
+
+typedef struct shader_symbol
+{
+    uint64_t hash;
+    char* name;  // NULL marks an empty slot
+    GLint location;
+} shader_symbol;
+
+// open addressing with linear probing, kept at most half full
+typedef struct shader_symbol_table
+{
+    shader_symbol* slots;
+    uint32_t mask;
+} shader_symbol_table;
+
+typedef struct shader_reflection
+{
+    GLint uniforms[SHADER_UNIFORM_COUNT];
+    shader_symbol_table uniform_table;
+    shader_symbol_table attribute_table;
+} shader_reflection;
+
+// indexed by program name, GL hands out small consecutive names
+static struct
+{
+    shader_reflection** programs;
+    GLuint capacity;
+} reflections;
+
+static void shader_symbol_table_init(shader_symbol_table* table, int count)
+{
+    uint32_t capacity = 8;
+    while (capacity < (uint32_t) count * 2)
+        capacity *= 2;
+
+    table->slots = calloc(capacity, sizeof(shader_symbol));
+    my_assert(table->slots, "failed to allocate shader symbol table");
+    table->mask = capacity - 1;
+}
+
+static void shader_symbol_table_free(shader_symbol_table* table)
+{
+    for (uint32_t i = 0; table->slots && i <= table->mask; i++)
+        free(table->slots[i].name);
+    free(table->slots);
+    table->slots = NULL;
+}
+
+static void shader_symbol_table_insert(shader_symbol_table* table, const char* name, size_t length, GLint location)
+{
+    uint64_t hash = hash_fnv1a(name, length, HASH_FNV1A_SEED);
+    uint32_t i = (uint32_t) hash & table->mask;
+    while (table->slots[i].name)
+    {
+        if (table->slots[i].hash == hash && strncmp(table->slots[i].name, name, length) == 0 && table->slots[i].name[length] == '\0')
+            return;
+        i = (i + 1) & table->mask;
+    }
+
+    table->slots[i] = (shader_symbol) {
+        .hash = hash,
+        .name = strndup(name, length),
+        .location = location
+    };
+}
+
+static GLint shader_symbol_table_find(const shader_symbol_table* table, const char* name)
+{
+    uint64_t hash = hash_fnv1a(name, strlen(name), HASH_FNV1A_SEED);
+    for (uint32_t i = (uint32_t) hash & table->mask; table->slots[i].name; i = (i + 1) & table->mask)
+        if (table->slots[i].hash == hash && strcmp(table->slots[i].name, name) == 0)
+            return table->slots[i].location;
+    return -1;
+}
+
+static void shader_reflection_free(GLuint program)
+{
+    if (program >= reflections.capacity || reflections.programs[program] == NULL)
+        return;
+
+    shader_reflection* reflection = reflections.programs[program];
+    shader_symbol_table_free(&reflection->uniform_table);
+    shader_symbol_table_free(&reflection->attribute_table);
+    free(reflection);
+    reflections.programs[program] = NULL;
+}
+
+static const shader_reflection* shader_reflection_get(GLuint program)
+{
+    return program < reflections.capacity ? reflections.programs[program] : NULL;
+}
+
+void shader_reflect(GLuint program)
+{
+    if (program >= reflections.capacity)
+    {
+        GLuint capacity = reflections.capacity ? reflections.capacity : 64;
+        while (capacity <= program)
+            capacity *= 2;
+
+        reflections.programs = realloc(reflections.programs, sizeof(shader_reflection*) * capacity);
+        my_assert(reflections.programs, "failed to grow shader reflection table");
+        memset(reflections.programs + reflections.capacity, 0, sizeof(shader_reflection*) * (capacity - reflections.capacity));
+        reflections.capacity = capacity;
+    }
+    shader_reflection_free(program);
+
+    shader_reflection* reflection = calloc(1, sizeof(shader_reflection));
+    my_assert(reflection, "failed to allocate shader reflection");
+
+    GLint uniform_count = 0, attribute_count = 0, uniform_length = 0, attribute_length = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniform_count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &uniform_length);
+    glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &attribute_count);
+    glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &attribute_length);
+
+    char* name = malloc((uniform_length > attribute_length ? uniform_length : attribute_length) + 1);
+    my_assert(name, "failed to allocate uniform name");
+
+    // arrays are entered twice, as "name[0]" and "name"
+    // nameless uniforms only leave their locations, ids fall back to them when that location is active
+    bool named = true;
+    bool active_locations[SHADER_UNIFORM_COUNT] = { false };
+    shader_symbol_table_init(&reflection->uniform_table, uniform_count * 2);
+    for (GLint i = 0; i < uniform_count; i++)
+    {
+        GLsizei length = 0;
+        GLint size;
+        GLenum type;
+        glGetActiveUniform(program, i, uniform_length + 1, &length, &size, &type, name);
+
+        // SPIR-V modules do not have to carry names
+        if (length == 0)
+        {
+            named = false;
+            GLint location = -1;
+            const GLenum property = GL_LOCATION;
+            if (gl_ext.get_program_resourceiv)
+                gl_ext.get_program_resourceiv(program, GL_UNIFORM, (GLuint) i, 1, &property, 1, NULL, &location);
+            if (location >= 0 && location < SHADER_UNIFORM_COUNT)
+                active_locations[location] = true;
+            continue;
+        }
+
+        // members of uniform blocks have no location
+        GLint location = glGetUniformLocation(program, name);
+        if (location < 0)
+            continue;
+
+        shader_symbol_table_insert(&reflection->uniform_table, name, length, location);
+        if (length > 3 && strcmp(name + length - 3, "[0]") == 0)
+            shader_symbol_table_insert(&reflection->uniform_table, name, length - 3, location);
+    }
+
+    shader_symbol_table_init(&reflection->attribute_table, attribute_count);
+    for (GLint i = 0; i < attribute_count; i++)
+    {
+        GLsizei length = 0;
+        GLint size;
+        GLenum type;
+        glGetActiveAttrib(program, i, attribute_length + 1, &length, &size, &type, name);
+
+        GLint location = glGetAttribLocation(program, name);
+        if (location >= 0)
+            shader_symbol_table_insert(&reflection->attribute_table, name, length, location);
+    }
+    free(name);
+    gl_check_error();
+
+    for (int i = 0; i < SHADER_UNIFORM_COUNT; i++)
+    {
+        reflection->uniforms[i] = shader_symbol_table_find(&reflection->uniform_table, shader_uniform_names[i]);
+        if (reflection->uniforms[i] < 0 && !named && active_locations[i])
+            reflection->uniforms[i] = i;
+    }
+
+    reflections.programs[program] = reflection;
+
+    // binding is reset by every link, so it is set here instead of in the shader
+    frame_uniforms_attach(program);
+}
+
+GLint shader_uniform_location(GLuint program, shader_uniform uniform)
+{
+    const shader_reflection* reflection = shader_reflection_get(program);
+    my_assert(reflection, "program has no reflection table");
+    return reflection->uniforms[uniform];
+}
+
+GLint shader_uniform_find(GLuint program, const char* name)
+{
+    const shader_reflection* reflection = shader_reflection_get(program);
+    my_assert(reflection, "program has no reflection table");
+    return shader_symbol_table_find(&reflection->uniform_table, name);
+}
+
+GLint shader_attribute_find(GLuint program, const char* name)
+{
+    const shader_reflection* reflection = shader_reflection_get(program);
+    my_assert(reflection, "program has no reflection table");
+    return shader_symbol_table_find(&reflection->attribute_table, name);
+}
+
+void shader_program_delete(GLuint program)
+{
+    shader_reflection_free(program);
+    glDeleteProgram(program);
+}
+
+void shader_reflection_shutdown(void)
+{
+    for (GLuint program = 0; program < reflections.capacity; program++)
+        shader_reflection_free(program);
+    free(reflections.programs);
+    reflections.programs = NULL;
+    reflections.capacity = 0;
+}
@@ -0,0 +1,55 @@
+#ifndef __SHADER_REFLECTION_H__
+#define __SHADER_REFLECTION_H__
+
+#include <glad/glad.h>
+
+// uniforms with compile-time ids, their locations are resolved once per program at link time
+// SPIR-V programs may come without names, shaders then declare them at layout(location = <id>)
+// (see shaders/spirv.glsl), and that location is used
+typedef enum shader_uniform
+{
+    SHADER_UNIFORM_MODEL,
+    SHADER_UNIFORM_VIEW,
+    SHADER_UNIFORM_PROJECTION,
+    SHADER_UNIFORM_TEXTURE1,
+    SHADER_UNIFORM_MVP,             // model, view and projection combined on the CPU (see transform.h)
+    SHADER_UNIFORM_NORMAL_MATRIX,
+    SHADER_UNIFORM_POSITION_SCALE,  // decode of quantized positions (see vertex_format.h)
+    SHADER_UNIFORM_POSITION_OFFSET,
+    SHADER_UNIFORM_COUNT
+} shader_uniform;
+
+/**
+ * enumerates active uniforms and attributes of a linked program into its reflection table
+ * and attaches its Frame block to the shared frame uniforms (see frame_uniforms.h)
+ * called by the shader batch for every program it builds or loads from the program cache
+ */
+void shader_reflect(GLuint program);
+
+/**
+ * location of a uniform by id, an array lookup, -1 when the program does not use it
+ */
+GLint shader_uniform_location(GLuint program, shader_uniform uniform);
+
+/**
+ * location of any active uniform by name from the hashed table, -1 when not active
+ * array uniforms are found both as "name" and "name[0]"
+ */
+GLint shader_uniform_find(GLuint program, const char* name);
+
+/**
+ * location of an active vertex attribute by name, -1 when not active
+ */
+GLint shader_attribute_find(GLuint program, const char* name);
+
+/**
+ * deletes program together with its reflection table
+ */
+void shader_program_delete(GLuint program);
+
+/**
+ * frees all reflection tables, programs are not deleted
+ */
+void shader_reflection_shutdown(void);
+
+#endif // __SHADER_REFLECTION_H__
@@ -0,0 +1,75 @@
+#include "shader_spirv.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "gl_ext.h"
+
+#define ENABLE_LOGS
+#include "debug.h"
+
+#define SHADER_SPIRV_MAGIC 0x07230203u
+#define SHADER_SPIRV_MAX_STAGES 2
+
+static uint32_t* shader_spirv_read(const char* path, size_t* size)
+{
+    FILE* f = fopen(path, "rb");
+    if (f == NULL)
+        return NULL;
+
+    fseek(f, 0, SEEK_END);
+    long length = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    // word stream starting with the magic number
+    uint32_t* words = NULL;
+    bool ok = length >= 20 && length % 4 == 0
+           && (words = malloc(length)) != NULL
+           && fread(words, 1, length, f) == (size_t) length
+           && words[0] == SHADER_SPIRV_MAGIC;
+    fclose(f);
+
+    if (!ok)
+    {
+        my_log(WARRMSG("invalid SPIR-V module: ") PATHMSG("%s\n"), path);
+        free(words);
+        return NULL;
+    }
+
+    *size = length;
+    return words;
+}
+
+bool shader_spirv_load(const GLuint* shaders, char* const* sources, int count)
+{
+    if (gl_ext.specialize_shader == NULL)
+        return false;
+    my_assert(count <= SHADER_SPIRV_MAX_STAGES, "too many SPIR-V stages");
+
+    uint32_t* modules[SHADER_SPIRV_MAX_STAGES] = { 0 };
+    size_t sizes[SHADER_SPIRV_MAX_STAGES] = { 0 };
+
+    bool found = true;
+    for (int i = 0; i < count && found; i++)
+    {
+        char path[256];
+        shader_spirv_path(sources[i], path, sizeof(path));
+        modules[i] = shader_spirv_read(path, &sizes[i]);
+        found = modules[i] != NULL;
+    }
+
+    if (found)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            gl_ext.shader_binary(1, &shaders[i], GL_SHADER_BINARY_FORMAT_SPIR_V, modules[i], (GLsizei) sizes[i]);
+            // like glCompileShader, the result is read with GL_COMPILE_STATUS
+            gl_ext.specialize_shader(shaders[i], "main", 0, NULL, NULL);
+        }
+        gl_check_error();
+    }
+
+    for (int i = 0; i < count; i++)
+        free(modules[i]);
+    return found;
+}
@@ -0,0 +1,33 @@
+#ifndef __SHADER_SPIRV_H__
+#define __SHADER_SPIRV_H__
+
+#include <glad/glad.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "utils.h"
+
+// precompiled modules, one file per preprocessed source: ./shaders/spirv/<hash>.spv (make spirv)
+#define SHADER_SPIRV_DIR "./shaders/spirv"
+
+/**
+ * module path of a preprocessed source, named by hash_fnv1a() of the text
+ * an edited source (or other defines) hashes differently, a stale module is never found
+ * inline so tools/shader_spirv.c names modules without linking GL
+ */
+static inline void shader_spirv_path(const char* source, char* out, size_t out_size)
+{
+    uint64_t hash = hash_fnv1a(source, strlen(source), HASH_FNV1A_SEED);
+    snprintf(out, out_size, SHADER_SPIRV_DIR "/%016llx.spv", (unsigned long long) hash);
+}
+
+/**
+ * loads modules of all preprocessed sources into shaders with glShaderBinary and specializes "main"
+ * a program cannot mix SPIR-V and GLSL, so nothing is touched unless every module is found
+ * returns false when the context lacks SPIR-V support or a module is missing
+ */
+bool shader_spirv_load(const GLuint* shaders, char* const* sources, int count);
+
+#endif // __SHADER_SPIRV_H__
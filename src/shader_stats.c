@@ -0,0 +1,116 @@
+#include "shader_stats.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define ENABLE_LOGS
+#include "debug.h"
+
+static struct
+{
+    shader_stat* stats;
+    int count;
+    int capacity;
+} shader_stats;
+
+double shader_stats_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec * 1e-6;
+}
+
+static const char* shader_stat_file_name(const char* path)
+{
+    const char* slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+void shader_stat_init(shader_stat* stat, const char* vertex_path, const char* fragment_path, const char* defines)
+{
+    *stat = (shader_stat) { 0 };
+    snprintf(stat->program, sizeof(stat->program), "%s + %s", shader_stat_file_name(vertex_path), shader_stat_file_name(fragment_path));
+
+    // "#define A 1\n#define B 1\n" is shown as "A,B"
+    size_t length = 0;
+    for (const char* p = defines; p && (p = strstr(p, "#define ")) != NULL;)
+    {
+        p += strlen("#define ");
+        size_t name_length = strcspn(p, " \t\n");
+        if (length + name_length + 2 > sizeof(stat->variant))
+            break;
+
+        if (length)
+            stat->variant[length++] = ',';
+        memcpy(stat->variant + length, p, name_length);
+        length += name_length;
+        stat->variant[length] = '\0';
+        p += name_length;
+    }
+}
+
+void shader_stats_record(const shader_stat* stat)
+{
+    if (shader_stats.count == shader_stats.capacity)
+    {
+        shader_stats.capacity = shader_stats.capacity ? shader_stats.capacity * 2 : 32;
+        shader_stats.stats = realloc(shader_stats.stats, sizeof(shader_stat) * shader_stats.capacity);
+        my_assert(shader_stats.stats, "failed to grow shader stats");
+    }
+    shader_stats.stats[shader_stats.count++] = *stat;
+}
+
+int shader_stats_count(void)
+{
+    return shader_stats.count;
+}
+
+const shader_stat* shader_stats_get(int index)
+{
+    my_assert(index >= 0 && index < shader_stats.count, "shader stat index out of range");
+    return &shader_stats.stats[index];
+}
+
+static int shader_stat_compare(const void* a, const void* b)
+{
+    double ta = ((const shader_stat*) a)->total_ms;
+    double tb = ((const shader_stat*) b)->total_ms;
+    return (ta < tb) - (ta > tb);
+}
+
+void shader_stats_dump(void)
+{
+    if (shader_stats.count == 0)
+        return;
+
+    shader_stat* sorted = malloc(sizeof(shader_stat) * shader_stats.count);
+    my_assert(sorted, "failed to allocate shader stats");
+    memcpy(sorted, shader_stats.stats, sizeof(shader_stat) * shader_stats.count);
+    qsort(sorted, shader_stats.count, sizeof(shader_stat), shader_stat_compare);
+
+    double total = 0.0;
+    printf("%-32s %-24s %-16s %8s %5s %5s %9s %9s %9s %9s\n",
+           "program", "variant", "key", "bytes", "cache", "input", "prep ms", "comp ms", "link ms", "total ms");
+    for (int i = 0; i < shader_stats.count; i++)
+    {
+        const shader_stat* stat = &sorted[i];
+        printf("%-32.32s %-24.24s %016llx %8zu %5s %5s %9.2f %9.2f %9.2f %9.2f%s\n",
+               stat->program, stat->variant[0] ? stat->variant : "-", (unsigned long long) stat->key,
+               stat->source_bytes, stat->cache_hit ? "hit" : "miss", stat->spirv ? "spirv" : "glsl",
+               stat->preprocess_ms, stat->compile_ms, stat->link_ms, stat->total_ms,
+               stat->failed ? "  FAILED" : "");
+        total += stat->total_ms;
+    }
+    printf("%d shader builds, %.2f ms total\n", shader_stats.count, total);
+
+    free(sorted);
+}
+
+void shader_stats_clear(void)
+{
+    free(shader_stats.stats);
+    shader_stats.stats = NULL;
+    shader_stats.count = shader_stats.capacity = 0;
+}
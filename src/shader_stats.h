@@ -0,0 +1,52 @@
+#ifndef __SHADER_STATS_H__
+#define __SHADER_STATS_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHADER_STAT_NAME_SIZE 64
+
+// one build of a program by the shader batch, startup and hot reloads alike
+typedef struct shader_stat
+{
+    char program[SHADER_STAT_NAME_SIZE];  // "vertex.vert + fragment.frag"
+    char variant[SHADER_STAT_NAME_SIZE];  // injected defines, empty for the base variant
+    uint64_t key;                         // program cache key
+    size_t source_bytes;                  // preprocessed, both stages
+    double preprocess_ms;
+    double compile_ms;                    // issuing compiles, glProgramBinary on a cache hit
+    double link_ms;                       // issuing link and reading its status
+    double total_ms;                      // submit to ready, includes frames a polled batch waited
+    bool cache_hit;
+    bool spirv;                           // stages from precompiled SPIR-V modules
+    bool failed;
+} shader_stat;
+
+/**
+ * clears stat and fills program and variant names, defines may be NULL
+ */
+void shader_stat_init(shader_stat* stat, const char* vertex_path, const char* fragment_path, const char* defines);
+
+void shader_stats_record(const shader_stat* stat);
+
+int shader_stats_count(void);
+
+/**
+ * stats in recording order
+ */
+const shader_stat* shader_stats_get(int index);
+
+/**
+ * prints every build as a table, most expensive (by total time) first
+ */
+void shader_stats_dump(void);
+
+void shader_stats_clear(void);
+
+/**
+ * monotonic time in milliseconds
+ */
+double shader_stats_now(void);
+
+#endif // __SHADER_STATS_H__
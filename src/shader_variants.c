@@ -0,0 +1,157 @@
+#include "shader_variants.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "shader.h"
+#include "shader_reflection.h"
+
+#define ENABLE_LOGS
+#include "debug.h"
+
+struct shader_variants
+{
+    char* paths[2];
+    char* features[SHADER_VARIANT_FEATURES_MAX];
+    int feature_count;
+    shader_reload_fn on_reload;
+    void* user;
+
+    // indexed directly by mask, 1 << feature_count entries
+    GLuint* programs;
+    bool* failed;
+};
+
+shader_variants_t* shader_variants_create(const char* vertex_path, const char* fragment_path,
+                                          const char* const* features, int feature_count,
+                                          shader_reload_fn on_reload, void* user)
+{
+    my_assert(feature_count >= 0 && feature_count <= SHADER_VARIANT_FEATURES_MAX, "too many shader features");
+
+    shader_variants_t* variants = calloc(1, sizeof(shader_variants_t));
+    my_assert(variants, "failed to allocate shader variants");
+
+    variants->paths[0] = strdup(vertex_path);
+    variants->paths[1] = strdup(fragment_path);
+    for (int i = 0; i < feature_count; i++)
+        variants->features[i] = strdup(features[i]);
+    variants->feature_count = feature_count;
+    variants->on_reload = on_reload;
+    variants->user = user;
+
+    variants->programs = calloc(1u << feature_count, sizeof(GLuint));
+    variants->failed = calloc(1u << feature_count, sizeof(bool));
+    my_assert(variants->programs && variants->failed, "failed to allocate shader variants");
+
+    return variants;
+}
+
+void shader_variants_destroy(shader_variants_t* variants)
+{
+    if (variants == NULL)
+        return;
+
+    for (uint32_t mask = 0; mask < 1u << variants->feature_count; mask++)
+    {
+        if (variants->programs[mask] || variants->failed[mask])
+            shader_watch_remove(&variants->programs[mask]);
+        if (variants->programs[mask])
+            shader_program_delete(variants->programs[mask]);
+    }
+
+    for (int i = 0; i < variants->feature_count; i++)
+        free(variants->features[i]);
+    free(variants->paths[0]);
+    free(variants->paths[1]);
+    free(variants->programs);
+    free(variants->failed);
+    free(variants);
+}
+
+/**
+ * "#define <feature> 1\n" for every bit of mask, NULL for the base variant
+ */
+static char* shader_variants_defines(const shader_variants_t* variants, uint32_t mask)
+{
+    if (mask == 0)
+        return NULL;
+
+    size_t size = 1;
+    for (int i = 0; i < variants->feature_count; i++)
+        if (mask & (1u << i))
+            size += strlen(variants->features[i]) + sizeof("#define  1\n") - 1;
+
+    char* defines = malloc(size);
+    my_assert(defines, "failed to allocate shader defines");
+
+    char* out = defines;
+    for (int i = 0; i < variants->feature_count; i++)
+        if (mask & (1u << i))
+            out += sprintf(out, "#define %s 1\n", variants->features[i]);
+    *out = '\0';
+
+    return defines;
+}
+
+void shader_variants_prepare(shader_variants_t* variants, const uint32_t* masks, int count)
+{
+    shader_batch_t* batch = shader_batch_create();
+    int* builds = malloc(sizeof(int) * count);
+    my_assert(builds, "failed to allocate shader variant builds");
+
+    for (int i = 0; i < count; i++)
+    {
+        uint32_t mask = masks[i];
+        my_assert(mask < 1u << variants->feature_count, "shader variant mask out of range");
+
+        builds[i] = -1;
+        if (variants->programs[mask] || variants->failed[mask])
+            continue;
+
+        // a mask listed twice is built once
+        bool queued = false;
+        for (int j = 0; j < i; j++)
+            queued |= masks[j] == mask;
+        if (queued)
+            continue;
+
+        char* defines = shader_variants_defines(variants, mask);
+        builds[i] = shader_batch_add(batch, variants->paths[0], variants->paths[1], defines);
+        free(defines);
+    }
+
+    shader_batch_submit(batch);
+    shader_batch_wait(batch);
+
+    for (int i = 0; i < count; i++)
+    {
+        if (builds[i] < 0)
+            continue;
+
+        uint32_t mask = masks[i];
+        variants->programs[mask] = shader_batch_program(batch, builds[i]);
+        variants->failed[mask] = variants->programs[mask] == 0;
+        my_log_if(variants->failed[mask], ERRMSG("failed to build shader variant: ") PATHMSG("%s %s") " mask 0x%x\n",
+                  variants->paths[0], variants->paths[1], mask);
+
+        // failed variants are watched too, a fixed source swaps the program in
+        char* defines = shader_variants_defines(variants, mask);
+        shader_watch_add(&variants->programs[mask], variants->paths[0], variants->paths[1], defines,
+                         variants->on_reload, variants->user);
+        free(defines);
+    }
+
+    shader_batch_destroy(batch);
+    free(builds);
+}
+
+GLuint shader_variants_get(shader_variants_t* variants, uint32_t mask)
+{
+    my_assert(mask < 1u << variants->feature_count, "shader variant mask out of range");
+
+    if (variants->programs[mask] == 0 && !variants->failed[mask])
+        shader_variants_prepare(variants, &mask, 1);
+    return variants->programs[mask];
+}
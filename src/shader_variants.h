@@ -0,0 +1,42 @@
+#ifndef __SHADER_VARIANTS_H__
+#define __SHADER_VARIANTS_H__
+
+#include <glad/glad.h>
+#include <stdint.h>
+
+#include "shader_watch.h"
+
+#define SHADER_VARIANT_FEATURES_MAX 8
+
+/**
+ * vertex + fragment pair compiled once per feature set instead of branching in one uber shader
+ * bit i of a mask enables features[i], injected into both stages as #define <features[i]> 1
+ * every variant has its own program cache entry and is hot reloaded on its own
+ */
+typedef struct shader_variants shader_variants_t;
+
+/**
+ * on_reload (may be NULL) is called for every reloaded variant
+ */
+shader_variants_t* shader_variants_create(const char* vertex_path, const char* fragment_path,
+                                          const char* const* features, int feature_count,
+                                          shader_reload_fn on_reload, void* user);
+
+/**
+ * deletes every variant program
+ */
+void shader_variants_destroy(shader_variants_t* variants);
+
+/**
+ * builds given variants in one shader batch so the driver compiles them in parallel
+ * variants built (or failed) already are skipped
+ */
+void shader_variants_prepare(shader_variants_t* variants, const uint32_t* masks, int count);
+
+/**
+ * program of variant, O(1), built on first use when it was not prepared
+ * returns 0 when the variant fails to build, it is not retried until its sources change
+ */
+GLuint shader_variants_get(shader_variants_t* variants, uint32_t mask);
+
+#endif // __SHADER_VARIANTS_H__
@@ -0,0 +1,298 @@
+#include "shader_watch.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "shader.h"
+#include "shader_preprocessor.h"
+#include "shader_reflection.h"
+
+#define ENABLE_LOGS
+#include "debug.h"
+
+// editors either rewrite the file in place or rename a temporary over it
+#define SHADER_WATCH_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO)
+
+typedef struct shader_watch_file
+{
+    char* path;
+    const char* name;  // file name inside path, matched against inotify events
+    int wd;            // watch descriptor of its directory
+} shader_watch_file;
+
+typedef struct shader_watch_entry
+{
+    GLuint* program;
+    char* paths[2];
+    char* defines;
+    shader_watch_file* files;  // both stages and everything they include
+    int file_count;
+    shader_reload_fn on_reload;
+    void* user;
+    bool dirty;                // changed since last submit
+    int build;                 // index in the batch in flight, -1 when not being rebuilt
+} shader_watch_entry;
+
+static struct
+{
+    int fd;
+    shader_watch_entry* entries;
+    int count;
+    int capacity;
+    shader_batch_t* batch;  // reloads in flight, at most one batch at a time
+} watch = { .fd = -1 };
+
+bool shader_watch_init(void)
+{
+    if (watch.fd >= 0)
+        return true;
+
+    watch.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watch.fd < 0)
+    {
+        my_log(WARRMSG("shader hot reload disabled: ") "inotify_init1 failed (%s)\n", strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+static void shader_watch_files_free(shader_watch_entry* entry)
+{
+    for (int i = 0; i < entry->file_count; i++)
+        free(entry->files[i].path);
+    free(entry->files);
+    entry->files = NULL;
+    entry->file_count = 0;
+}
+
+static void shader_watch_entry_free(shader_watch_entry* entry)
+{
+    shader_watch_files_free(entry);
+    free(entry->paths[0]);
+    free(entry->paths[1]);
+    free(entry->defines);
+}
+
+void shader_watch_shutdown(void)
+{
+    // programs of a rebuild that was never swapped in belong to nobody else
+    for (int i = 0; i < watch.count; i++)
+    {
+        shader_watch_entry* entry = &watch.entries[i];
+        if (entry->build < 0)
+            continue;
+
+        shader_batch_wait(watch.batch);
+        GLuint rebuilt = shader_batch_program(watch.batch, entry->build);
+        if (rebuilt)
+            shader_program_delete(rebuilt);
+        entry->build = -1;
+    }
+
+    shader_batch_destroy(watch.batch);
+    watch.batch = NULL;
+
+    for (int i = 0; i < watch.count; i++)
+        shader_watch_entry_free(&watch.entries[i]);
+    free(watch.entries);
+    watch.entries = NULL;
+    watch.count = watch.capacity = 0;
+
+    if (watch.fd >= 0)
+        close(watch.fd);
+    watch.fd = -1;
+}
+
+/**
+ * watches directory of path, the same directory always gives the same descriptor
+ */
+static int shader_watch_directory(const char* path, const char** name)
+{
+    const char* slash = strrchr(path, '/');
+    *name = slash ? slash + 1 : path;
+
+    char dir[256];
+    if (slash == NULL)
+        strcpy(dir, ".");
+    else if (slash == path)
+        strcpy(dir, "/");
+    else
+        snprintf(dir, sizeof(dir), "%.*s", (int) (slash - path), path);
+
+    int wd = inotify_add_watch(watch.fd, dir, SHADER_WATCH_EVENTS);
+    if (wd < 0)
+        my_log(WARRMSG("failed to watch shader directory: ") PATHMSG("%s\n"), dir);
+    return wd;
+}
+
+/**
+ * (re)collects files of both stages, includes may have changed with the last edit
+ */
+static void shader_watch_collect(shader_watch_entry* entry)
+{
+    shader_watch_files_free(entry);
+
+    for (int stage = 0; stage < 2; stage++)
+    {
+        shader_source_files files = { 0 };
+        free(shader_preprocess(entry->paths[stage], NULL, &files));
+
+        entry->files = realloc(entry->files, sizeof(shader_watch_file) * (entry->file_count + files.count));
+        my_assert(entry->files, "failed to grow shader watch files");
+        for (int i = 0; i < files.count; i++)
+        {
+            shader_watch_file* file = &entry->files[entry->file_count++];
+            file->path = files.paths[i];
+            file->wd = shader_watch_directory(file->path, &file->name);
+            files.paths[i] = NULL;
+        }
+        shader_source_files_free(&files);
+    }
+}
+
+void shader_watch_add(GLuint* program, const char* vertex_path, const char* fragment_path, const char* defines, shader_reload_fn on_reload, void* user)
+{
+    if (watch.fd < 0)
+        return;
+
+    if (watch.count == watch.capacity)
+    {
+        watch.capacity = watch.capacity ? watch.capacity * 2 : 8;
+        watch.entries = realloc(watch.entries, sizeof(shader_watch_entry) * watch.capacity);
+        my_assert(watch.entries, "failed to grow shader watch list");
+    }
+
+    shader_watch_entry* entry = &watch.entries[watch.count++];
+    *entry = (shader_watch_entry) {
+        .program = program,
+        .paths = { strdup(vertex_path), strdup(fragment_path) },
+        .defines = defines ? strdup(defines) : NULL,
+        .on_reload = on_reload,
+        .user = user,
+        .build = -1
+    };
+    shader_watch_collect(entry);
+}
+
+void shader_watch_remove(GLuint* program)
+{
+    for (int i = 0; i < watch.count; i++)
+    {
+        shader_watch_entry* entry = &watch.entries[i];
+        if (entry->program != program)
+            continue;
+
+        // a rebuild in flight would otherwise leak its program
+        if (entry->build >= 0)
+        {
+            shader_batch_wait(watch.batch);
+            GLuint rebuilt = shader_batch_program(watch.batch, entry->build);
+            if (rebuilt)
+                shader_program_delete(rebuilt);
+        }
+
+        shader_watch_entry_free(entry);
+        watch.entries[i] = watch.entries[--watch.count];
+        return;
+    }
+}
+
+static void shader_watch_mark(int wd, const char* name)
+{
+    for (int i = 0; i < watch.count; i++)
+    {
+        shader_watch_entry* entry = &watch.entries[i];
+        for (int file = 0; file < entry->file_count; file++)
+            if (entry->files[file].wd == wd && strcmp(entry->files[file].name, name) == 0)
+                entry->dirty = true;
+    }
+}
+
+static void shader_watch_read_events(void)
+{
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+    ssize_t length;
+    while ((length = read(watch.fd, buffer, sizeof(buffer))) > 0)
+    {
+        for (char* ptr = buffer; ptr < buffer + length;)
+        {
+            const struct inotify_event* event = (const struct inotify_event*) ptr;
+            if (event->len > 0)
+                shader_watch_mark(event->wd, event->name);
+            ptr += sizeof(struct inotify_event) + event->len;
+        }
+    }
+}
+
+/**
+ * swaps all programs of the finished batch in one go, failed builds keep the old program
+ */
+static int shader_watch_swap(void)
+{
+    int swapped = 0;
+    for (int i = 0; i < watch.count; i++)
+    {
+        shader_watch_entry* entry = &watch.entries[i];
+        if (entry->build < 0)
+            continue;
+
+        GLuint program = shader_batch_program(watch.batch, entry->build);
+        entry->build = -1;
+        shader_watch_collect(entry);
+        if (program == 0)
+        {
+            my_log(WARRMSG("shader reload failed, keeping old program: ") PATHMSG("%s %s\n"), entry->paths[0], entry->paths[1]);
+            continue;
+        }
+
+        shader_program_delete(*entry->program);
+        *entry->program = program;
+        if (entry->on_reload)
+            entry->on_reload(program, entry->user);
+        gl_check_error();
+
+        my_log(SCCSMSG("reloaded shader program: ") PATHMSG("%s %s\n"), entry->paths[0], entry->paths[1]);
+        swapped++;
+    }
+
+    shader_batch_destroy(watch.batch);
+    watch.batch = NULL;
+    return swapped;
+}
+
+int shader_watch_update(void)
+{
+    if (watch.fd < 0)
+        return 0;
+
+    shader_watch_read_events();
+
+    int swapped = 0;
+    if (watch.batch)
+    {
+        if (!shader_batch_poll(watch.batch))
+            return 0;
+        swapped = shader_watch_swap();
+    }
+
+    // changes made while a batch was in flight go into the next one
+    for (int i = 0; i < watch.count; i++)
+    {
+        shader_watch_entry* entry = &watch.entries[i];
+        if (!entry->dirty)
+            continue;
+
+        if (watch.batch == NULL)
+            watch.batch = shader_batch_create();
+        entry->build = shader_batch_add(watch.batch, entry->paths[0], entry->paths[1], entry->defines);
+        entry->dirty = false;
+    }
+    if (watch.batch)
+        shader_batch_submit(watch.batch);
+
+    return swapped;
+}
@@ -0,0 +1,39 @@
+#ifndef __SHADER_WATCH_H__
+#define __SHADER_WATCH_H__
+
+#include <glad/glad.h>
+#include <stdbool.h>
+
+// called after a reloaded program replaced the old one, uniforms have to be set again
+typedef void (*shader_reload_fn)(GLuint program, void* user);
+
+/**
+ * starts watching shader sources with inotify, returns false when inotify is not available
+ */
+bool shader_watch_init(void);
+
+/**
+ * stops watching, programs stay alive and belong to their owners
+ */
+void shader_watch_shutdown(void);
+
+/**
+ * registers linked program built from given sources and defines (may be NULL),
+ * *program is replaced on every successful reload
+ * the directories of both sources and of the files they include are watched, on_reload may be NULL
+ */
+void shader_watch_add(GLuint* program, const char* vertex_path, const char* fragment_path, const char* defines, shader_reload_fn on_reload, void* user);
+
+/**
+ * stops reloading *program, which stays alive
+ */
+void shader_watch_remove(GLuint* program);
+
+/**
+ * per frame, never blocks: collects changed files, submits their programs as a shader batch
+ * and swaps in the ones that linked, a program that fails keeps the old one in use
+ * returns number of programs swapped this frame
+ */
+int shader_watch_update(void);
+
+#endif // __SHADER_WATCH_H__
@@ -0,0 +1,1016 @@
+#include "texture.h"
+
+#include <limits.h>
+#include <pthread.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "./vendor/stb_image.h"
+
+#include "gl_ext.h"
+#include "ktx2.h"
+#include "mipmap.h"
+#include "pbo_ring.h"
+#include "pixel.h"
+#include "texture_cache.h"
+#include "thread_pool.h"
+
+#define ENABLE_LOGS
+#include "debug.h"
+
+#define TEXTURE_INITIAL_CAPACITY 16
+// low bits of a handle are slot index + 1, the rest is the slot generation
+#define TEXTURE_HANDLE_INDEX_BITS 20
+#define TEXTURE_HANDLE_INDEX_MASK ((1u << TEXTURE_HANDLE_INDEX_BITS) - 1)
+// how long texture_wait_all() blocks on a single in-flight pixel buffer
+#define TEXTURE_STREAM_WAIT_NS 100000000ull
+// over budget a texture first loses this many top mip levels before it is evicted entirely
+#define TEXTURE_MAX_DROPPED_LEVELS 2
+
+typedef struct texture
+{
+    GLuint id;
+    int width;
+    int height;
+    int channels;
+    texture_state state;
+    texture_params params;
+    char* path;           // normalized, NULL for a free slot
+    uint64_t path_hash;
+    int refs;             // texture_load_async() calls not yet matched by texture_release()
+    unsigned int generation;  // bumped whenever the slot is freed, part of the handle
+
+    // residency bookkeeping
+    size_t bytes;             // GPU memory of the uploaded levels
+    size_t full_bytes;        // bytes with no levels dropped, known after first upload
+    unsigned int last_used;   // frame of the last texture_bind()
+    int dropped_levels;       // top mip levels left out of the resident texture
+    bool reloading;           // a job for this slot is in flight
+    size_t reload_savings;    // bytes the job in flight is expected to free, part of textures.pending_savings
+} texture_t;
+
+// one decode request, owned by the worker until it lands in the done list
+typedef struct texture_job
+{
+    texture_handle handle;
+    char* path;
+    texture_params params;
+    // top mip levels skipped by the upload, > 0 when the residency manager degrades a texture
+    int first_level;
+
+    // levels to upload, data points into one of the buffers below
+    mip_chain chain;
+    ktx2_file ktx2;                 // precompressed file next to the source
+    GLenum compressed_format;       // 0 for uncompressed levels
+    texture_cache_mapping mapping;  // cache hit
+    unsigned char* decoded;         // stb output when no chain was generated
+    bool owns_chain;
+    const char* failure_reason;
+
+    // set once a worker copied the chain into a mapped pixel buffer
+    pbo_slot slot;
+    bool staged;
+
+    // progressive upload, next level to upload counting down towards first_level
+    bool streaming;
+    int next_level;
+
+    struct texture_job* next;
+} texture_job_t;
+
+static struct
+{
+    bool initialized;
+    thread_pool_t* pool;
+
+    // slot i holds handles i + 1 tagged with its generation, only touched on the GL thread
+    texture_t* slots;
+    unsigned int count;
+    unsigned int capacity;
+
+    GLuint placeholder;
+    int pending;
+
+    // decoded jobs waiting for upload, filled by workers
+    pthread_mutex_t done_lock;
+    pthread_cond_t done_signal;
+    texture_job_t* done;
+
+    // optional streaming path, decoded jobs wait here while every ring slot is in flight
+    pbo_ring_t* ring;
+    texture_job_t* waiting;
+
+    // bytes left for progressive uploads in this texture_process()
+    size_t progressive_bytes;
+
+    // residency, budget 0 means unlimited
+    unsigned int frame;
+    size_t budget;
+    size_t resident_bytes;
+    size_t pending_savings;
+} textures;
+
+static GLenum texture_format_from_channels(int channels)
+{
+    switch (channels)
+    {
+        case 1: return GL_RED;
+        case 2: return GL_RG;
+        case 3: return GL_RGB;
+        default: return GL_RGBA;
+    }
+}
+
+/**
+ * sized internal format matching the decoded layout, so the driver never converts on upload
+ * sRGB only exists for RGB and RGBA, one and two channel images are always linear
+ */
+static GLenum texture_internal_format(int channels, bool srgb)
+{
+    switch (channels)
+    {
+        case 1: return GL_R8;
+        case 2: return GL_RG8;
+        case 3: return srgb ? GL_SRGB8 : GL_RGB8;
+        default: return srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+    }
+}
+
+/**
+ * GL format of a KTX2 file, 0 if the context cannot sample it
+ */
+static GLenum texture_compressed_format(uint32_t vk_format)
+{
+    switch (vk_format)
+    {
+        case KTX2_VK_FORMAT_BC1_RGB_UNORM: return gl_ext.texture_compression_s3tc ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : 0;
+        case KTX2_VK_FORMAT_BC1_RGB_SRGB:  return gl_ext.texture_compression_s3tc ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : 0;
+        case KTX2_VK_FORMAT_BC3_UNORM:     return gl_ext.texture_compression_s3tc ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : 0;
+        case KTX2_VK_FORMAT_BC3_SRGB:      return gl_ext.texture_compression_s3tc ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : 0;
+        case KTX2_VK_FORMAT_BC7_UNORM:     return gl_ext.texture_compression_bptc ? GL_COMPRESSED_RGBA_BPTC_UNORM : 0;
+        case KTX2_VK_FORMAT_BC7_SRGB:      return gl_ext.texture_compression_bptc ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : 0;
+        default:                           return 0;
+    }
+}
+
+static texture_handle texture_handle_of(const texture_t* texture)
+{
+    return (texture->generation << TEXTURE_HANDLE_INDEX_BITS) | ((texture_handle) (texture - textures.slots) + 1);
+}
+
+/**
+ * NULL for invalid handles and for handles of a slot freed since, even if it holds another texture now
+ */
+static texture_t* texture_from_handle(texture_handle handle)
+{
+    unsigned int index = handle & TEXTURE_HANDLE_INDEX_MASK;
+    if (index == 0 || index > textures.count)
+        return NULL;
+
+    texture_t* texture = &textures.slots[index - 1];
+    return texture_handle_of(texture) == handle ? texture : NULL;
+}
+
+static bool texture_swizzles(const texture_params* params)
+{
+    for (int i = 0; i < 4; i++)
+        if (params->swizzle[i] != i)
+            return true;
+    return false;
+}
+
+static bool texture_params_equal(const texture_params* a, const texture_params* b)
+{
+    return a->wrap_s == b->wrap_s && a->wrap_t == b->wrap_t
+        && a->min_filter == b->min_filter && a->mag_filter == b->mag_filter
+        && a->flip_vertically == b->flip_vertically && a->generate_mipmaps == b->generate_mipmaps
+        && a->srgb == b->srgb && a->use_cache == b->use_cache
+        && a->use_compressed == b->use_compressed && a->progressive == b->progressive
+        && a->expand_rgb == b->expand_rgb && a->premultiply_alpha == b->premultiply_alpha
+        && memcmp(a->swizzle, b->swizzle, sizeof(a->swizzle)) == 0;
+}
+
+/**
+ * deletes the GL object and frees the slot for reuse, called once the last reference is gone and no job is in flight
+ */
+static void texture_free(texture_t* texture)
+{
+    if (texture->id)
+        glDeleteTextures(1, &texture->id);
+    textures.resident_bytes -= texture->bytes;
+    free(texture->path);
+
+    // wraps within the bits left over by the index
+    unsigned int generation = (texture->generation + 1) & (~0u >> TEXTURE_HANDLE_INDEX_BITS);
+    *texture = (texture_t) { .state = TEXTURE_STATE_FAILED, .generation = generation };
+}
+
+static unsigned char* texture_read_file(const char* path, size_t* size)
+{
+    FILE* f = fopen(path, "rb");
+    if (f == NULL)
+        return NULL;
+
+    fseek(f, 0, SEEK_END);
+    long length = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    unsigned char* bytes = length > 0 ? malloc(length) : NULL;
+    if (bytes && fread(bytes, 1, length, f) != (size_t) length)
+    {
+        free(bytes);
+        bytes = NULL;
+    }
+    fclose(f);
+
+    *size = length;
+    return bytes;
+}
+
+static bool texture_job_has_pixels(const texture_job_t* job)
+{
+    return job->chain.level_count > 0;
+}
+
+/**
+ * levels are contiguous but not always largest first (KTX2 stores the smallest first)
+ * the span covers all uploaded levels without any file header, start receives its offset
+ */
+static size_t texture_job_span(const texture_job_t* job, size_t* start)
+{
+    const mip_chain* chain = &job->chain;
+    size_t first = chain->levels[job->first_level].offset;
+    size_t end = first + chain->levels[job->first_level].size;
+
+    for (int i = job->first_level + 1; i < chain->level_count; i++)
+    {
+        const mip_level* level = &chain->levels[i];
+        first = level->offset < first ? level->offset : first;
+        end = level->offset + level->size > end ? level->offset + level->size : end;
+    }
+
+    if (start)
+        *start = first;
+    return end - first;
+}
+
+static void texture_job_finish(texture_job_t* job)
+{
+    // never skip the smallest level
+    if (job->chain.level_count > 0 && job->first_level >= job->chain.level_count)
+        job->first_level = job->chain.level_count - 1;
+
+    pthread_mutex_lock(&textures.done_lock);
+    job->next = textures.done;
+    textures.done = job;
+    pthread_cond_signal(&textures.done_signal);
+    pthread_mutex_unlock(&textures.done_lock);
+}
+
+static void texture_job_release(texture_job_t* job)
+{
+    if (job->ktx2.base)
+        ktx2_unmap(&job->ktx2);
+    else if (job->mapping.base)
+        texture_cache_unmap(&job->mapping);
+    else if (job->owns_chain)
+        mip_chain_free(&job->chain);
+    stbi_image_free(job->decoded);
+    free(job->path);
+    free(job);
+}
+
+/**
+ * maps block compressed KTX2 sibling of the source if the context can sample it,
+ * its color space and row order match what the params ask for and it was converted from the current source
+ * source is NULL when only the compressed file ships
+ */
+static bool texture_map_compressed(texture_job_t* job, const unsigned char* source, size_t source_size)
+{
+    char ktx2_path_buffer[4096];
+    ktx2_path(job->path, ktx2_path_buffer, sizeof(ktx2_path_buffer));
+
+    if (!ktx2_map(ktx2_path_buffer, &job->ktx2))
+        return false;
+
+    // texconv writes straight alpha
+    GLenum format = texture_compressed_format(job->ktx2.vk_format);
+    bool stale = source && job->ktx2.source_hash != texture_cache_hash(source, source_size);
+    my_log_if(stale, WARRMSG("ignoring stale compressed texture, run make textures: ") PATHMSG("%s\n"), ktx2_path_buffer);
+    if (format == 0 || stale || !ktx2_matches(&job->ktx2, job->params.srgb, job->params.flip_vertically)
+        || job->params.premultiply_alpha || texture_swizzles(&job->params))
+    {
+        ktx2_unmap(&job->ktx2);
+        return false;
+    }
+
+    job->chain = job->ktx2.chain;
+    job->compressed_format = format;
+    return true;
+}
+
+/**
+ * conversion stage between decode and mip generation, on the worker
+ * may replace job->decoded and its channel count, fails only when out of memory
+ */
+static bool texture_convert(texture_job_t* job, int width, int height, int* channels)
+{
+    const texture_params* params = &job->params;
+    size_t count = (size_t) width * height;
+
+    // stb keeps the file's top-down order, GL wants the bottom row first
+    if (params->flip_vertically)
+        pixel_flip_vertical(job->decoded, width, height, *channels);
+
+    if (params->expand_rgb && *channels == 3)
+    {
+        unsigned char* expanded = malloc(count * 4);
+        if (expanded == NULL)
+            return false;
+        pixel_expand_rgb_rgba(job->decoded, expanded, count);
+        stbi_image_free(job->decoded);
+        job->decoded = expanded;
+        *channels = 4;
+    }
+
+    // premultiplication expects alpha in the last channel, so it runs on the swizzled texels
+    if (texture_swizzles(params) && *channels == 4)
+        pixel_swizzle_rgba(job->decoded, count, params->swizzle);
+
+    if (params->premultiply_alpha && *channels == 4)
+        pixel_premultiply_rgba(job->decoded, count);
+
+    return true;
+}
+
+/**
+ * worker side: resolves the image through a compressed file, the cache or decodes it,
+ * then hands it back to the GL thread
+ */
+static void texture_decode_job(void* arg)
+{
+    texture_job_t* job = arg;
+    const texture_params* params = &job->params;
+
+    size_t source_size = 0;
+    unsigned char* source = texture_read_file(job->path, &source_size);
+
+    if (params->use_compressed && texture_map_compressed(job, source, source_size))
+        goto done;
+
+    if (source == NULL)
+    {
+        job->failure_reason = "can't read file";
+        goto done;
+    }
+
+    uint32_t cache_flags = (params->flip_vertically ? TEXTURE_CACHE_FLIPPED : 0)
+                         | (params->generate_mipmaps ? TEXTURE_CACHE_MIPMAPPED : 0)
+                         | (params->srgb ? TEXTURE_CACHE_SRGB : 0)
+                         | (params->premultiply_alpha ? TEXTURE_CACHE_PREMULTIPLIED : 0)
+                         | (params->expand_rgb ? TEXTURE_CACHE_EXPANDED : 0);
+    if (texture_swizzles(params))
+        for (int i = 0; i < 4; i++)
+            cache_flags |= (uint32_t) (params->swizzle[i] & 3) << (TEXTURE_CACHE_SWIZZLE_SHIFT + i * 2);
+    uint64_t source_hash = 0;
+    char cache_path[4096];
+
+    if (params->use_cache)
+    {
+        source_hash = texture_cache_hash(source, source_size);
+        texture_cache_path(job->path, cache_path, sizeof(cache_path));
+
+        // warm start: pixels are uploaded straight from the mapping
+        if (texture_cache_map(cache_path, source_hash, cache_flags, &job->mapping))
+        {
+            job->chain = job->mapping.chain;
+            goto done;
+        }
+    }
+
+    int width, height, channels;
+    job->decoded = stbi_load_from_memory(source, source_size, &width, &height, &channels, 0);
+    if (job->decoded == NULL)
+    {
+        job->failure_reason = stbi_failure_reason();
+        goto done;
+    }
+
+    if (!texture_convert(job, width, height, &channels))
+    {
+        job->failure_reason = "out of memory";
+        goto done;
+    }
+
+    // mips are built here on the worker, not by the driver on the GL thread
+    if (params->generate_mipmaps && mip_chain_generate(&job->chain, job->decoded, width, height, channels, params->srgb))
+    {
+        job->owns_chain = true;
+        stbi_image_free(job->decoded);
+        job->decoded = NULL;
+    }
+    else
+    {
+        // single level, GL only builds the mips if the chain allocation failed
+        mip_chain_layout(&job->chain, width, height, channels, false);
+        job->chain.data = job->decoded;
+    }
+
+    // a failed mip allocation leaves a single level that must not be cached as mipmapped
+    if (params->use_cache && (job->owns_chain || !params->generate_mipmaps))
+        texture_cache_store(cache_path, source_hash, cache_flags, &job->chain);
+
+done:
+    free(source);
+    texture_job_finish(job);
+}
+
+/**
+ * worker side: fills the pixel buffer the GL thread mapped for this job
+ */
+static void texture_stage_job(void* arg)
+{
+    texture_job_t* job = arg;
+
+    size_t start;
+    size_t span = texture_job_span(job, &start);
+    memcpy(job->slot.ptr, job->chain.data + start, span);
+    job->staged = true;
+
+    texture_job_finish(job);
+}
+
+/**
+ * number of levels the GL texture gets, levels of a single level chain are generated by GL
+ */
+static int texture_storage_levels(const texture_t* texture, const texture_job_t* job, bool* generate_mipmaps)
+{
+    const mip_chain* chain = &job->chain;
+
+    // compressed formats cannot be mipmapped by GL, they carry their own chain
+    *generate_mipmaps = texture->params.generate_mipmaps && chain->level_count == 1 && !job->compressed_format;
+    if (*generate_mipmaps)
+        return mipmap_level_count(chain->levels[0].width, chain->levels[0].height);
+    return chain->level_count - job->first_level;
+}
+
+static GLenum texture_job_internal_format(const texture_t* texture, const texture_job_t* job)
+{
+    if (job->compressed_format)
+        return job->compressed_format;
+    return texture_internal_format(job->chain.channels, texture->params.srgb);
+}
+
+/**
+ * the job of the slot landed or was dropped, its expected saving no longer counts against the budget
+ */
+static void texture_reload_finished(texture_t* texture)
+{
+    textures.pending_savings -= texture->reload_savings;
+    texture->reload_savings = 0;
+    texture->reloading = false;
+}
+
+/**
+ * creates the GL texture for a job, with immutable storage for all levels when available
+ */
+static void texture_upload_begin(texture_t* texture, const texture_job_t* job)
+{
+    bool generate_mipmaps;
+    int storage_levels = texture_storage_levels(texture, job, &generate_mipmaps);
+
+    // a reload replaces the resident texture only now, it stays bound until here
+    if (texture->id)
+    {
+        glDeleteTextures(1, &texture->id);
+        textures.resident_bytes -= texture->bytes;
+        texture->bytes = 0;
+    }
+
+    glGenTextures(1, &texture->id);
+    glBindTexture(GL_TEXTURE_2D, texture->id);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, texture->params.wrap_s);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, texture->params.wrap_t);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, texture->params.min_filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, texture->params.mag_filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, storage_levels - 1);
+
+    // immutable storage is allocated once for all levels, levels are then only filled in
+    const mip_level* base = &job->chain.levels[job->first_level];
+    if (gl_ext.tex_storage_2d)
+        gl_ext.tex_storage_2d(GL_TEXTURE_2D, storage_levels, texture_job_internal_format(texture, job), base->width, base->height);
+
+    texture->width = job->chain.levels[0].width;
+    texture->height = job->chain.levels[0].height;
+    texture->channels = job->chain.channels;
+}
+
+/**
+ * uploads chain level i into the texture bound to GL_TEXTURE_2D
+ */
+static void texture_upload_level(const texture_t* texture, const texture_job_t* job, int i, const void* pixels)
+{
+    const mip_level* level = &job->chain.levels[i];
+    GLenum format = texture_format_from_channels(job->chain.channels);
+    GLenum internal_format = texture_job_internal_format(texture, job);
+    int gl_level = i - job->first_level;
+
+    // rows of 1 and 3 channel images are not 4 byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (gl_ext.tex_storage_2d && job->compressed_format)
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, gl_level, 0, 0, level->width, level->height, internal_format, level->size, pixels);
+    else if (gl_ext.tex_storage_2d)
+        glTexSubImage2D(GL_TEXTURE_2D, gl_level, 0, 0, level->width, level->height, format, GL_UNSIGNED_BYTE, pixels);
+    else if (job->compressed_format)
+        glCompressedTexImage2D(GL_TEXTURE_2D, gl_level, internal_format, level->width, level->height, 0, level->size, pixels);
+    else
+        glTexImage2D(GL_TEXTURE_2D, gl_level, internal_format, level->width, level->height, 0, format, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+/**
+ * marks the texture ready once all levels of the job are uploaded, bytes is their total size
+ */
+static void texture_upload_end(texture_t* texture, const texture_job_t* job, size_t bytes)
+{
+    bool generate_mipmaps;
+    texture_storage_levels(texture, job, &generate_mipmaps);
+    if (generate_mipmaps)
+    {
+        glGenerateMipmap(GL_TEXTURE_2D);
+        // the driver adds roughly a third on top of the base level
+        bytes += bytes / 3;
+    }
+    gl_check_error();
+
+    texture->state = TEXTURE_STATE_READY;
+    texture_reload_finished(texture);
+
+    textures.resident_bytes += bytes - texture->bytes;
+    texture->bytes = bytes;
+    texture->dropped_levels = job->first_level;
+    if (job->first_level == 0)
+        texture->full_bytes = bytes;
+}
+
+/**
+ * pixels is the address of the level span, or its byte offset when a pixel unpack buffer is bound
+ */
+static void texture_upload(texture_t* texture, const texture_job_t* job, uintptr_t pixels)
+{
+    size_t start;
+    size_t bytes = texture_job_span(job, &start);
+
+    texture_upload_begin(texture, job);
+    for (int i = job->first_level; i < job->chain.level_count; i++)
+        texture_upload_level(texture, job, i, (const void*) (pixels + job->chain.levels[i].offset - start));
+    texture_upload_end(texture, job, bytes);
+}
+
+/**
+ * uploads the next levels of a progressive job, smallest first, until the frame's upload bytes run out
+ * base level is clamped to the largest level so far, so the texture samples only complete levels
+ * returns true once every level is in
+ */
+static bool texture_upload_progressive(texture_t* texture, texture_job_t* job)
+{
+    const mip_chain* chain = &job->chain;
+
+    if (!job->streaming)
+    {
+        texture_upload_begin(texture, job);
+        job->streaming = true;
+        job->next_level = chain->level_count - 1;
+    }
+    else
+    {
+        glBindTexture(GL_TEXTURE_2D, texture->id);
+    }
+
+    do
+    {
+        const mip_level* level = &chain->levels[job->next_level];
+        texture_upload_level(texture, job, job->next_level, chain->data + level->offset);
+        texture->bytes += level->size;
+        textures.resident_bytes += level->size;
+        textures.progressive_bytes -= level->size < textures.progressive_bytes ? level->size : textures.progressive_bytes;
+        job->next_level--;
+    }
+    while (job->next_level >= job->first_level && chain->levels[job->next_level].size <= textures.progressive_bytes);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, job->next_level + 1 - job->first_level);
+    gl_check_error();
+
+    // drawable from the first pass on, with whatever detail arrived
+    texture->state = TEXTURE_STATE_READY;
+    if (job->next_level >= job->first_level)
+        return false;
+
+    texture_upload_end(texture, job, texture_job_span(job, NULL));
+    return true;
+}
+
+/**
+ * queues (re)load of a slot, the resident texture if any stays bound until the job is uploaded
+ * savings is the memory the reload is expected to free, 0 when it does not shrink the texture
+ */
+static void texture_queue_job(texture_handle handle, int first_level, size_t savings)
+{
+    texture_t* texture = texture_from_handle(handle);
+
+    texture_job_t* job = calloc(1, sizeof(texture_job_t));
+    my_assert(job, "failed to allocate texture job");
+    job->handle = handle;
+    job->path = strdup(texture->path);
+    job->params = texture->params;
+    job->first_level = first_level;
+
+    texture->reloading = true;
+    texture->reload_savings = savings;
+    textures.pending_savings += savings;
+    textures.pending++;
+    thread_pool_submit(textures.pool, texture_decode_job, job);
+}
+
+static void texture_evict(texture_t* texture)
+{
+    glDeleteTextures(1, &texture->id);
+    texture->id = 0;
+    textures.resident_bytes -= texture->bytes;
+    texture->bytes = 0;
+    texture->state = TEXTURE_STATE_EVICTED;
+}
+
+/**
+ * least recently bound resident texture that was not used this frame
+ */
+static texture_t* texture_find_victim(void)
+{
+    texture_t* victim = NULL;
+    for (unsigned int i = 0; i < textures.count; i++)
+    {
+        texture_t* texture = &textures.slots[i];
+        if (texture->state != TEXTURE_STATE_READY || texture->reloading || texture->last_used == textures.frame)
+            continue;
+        if (victim == NULL || texture->last_used < victim->last_used)
+            victim = texture;
+    }
+    return victim;
+}
+
+/**
+ * degrades least recently used textures until the resident set fits the budget
+ * a victim first gets reloaded without its top mip, after TEXTURE_MAX_DROPPED_LEVELS it is evicted
+ */
+static void texture_enforce_budget(void)
+{
+    if (textures.budget == 0)
+        return;
+
+    // reloads in flight will free memory too, count what they are expected to save
+    size_t projected = textures.resident_bytes > textures.pending_savings ? textures.resident_bytes - textures.pending_savings : 0;
+
+    while (projected > textures.budget)
+    {
+        texture_t* victim = texture_find_victim();
+        if (victim == NULL)
+            break;
+
+        // dropping a level keeps about a quarter of the memory
+        size_t reduced = victim->bytes / 4;
+        bool can_drop = victim->params.generate_mipmaps && victim->dropped_levels < TEXTURE_MAX_DROPPED_LEVELS
+                     && (victim->width >> (victim->dropped_levels + 1)) > 0 && (victim->height >> (victim->dropped_levels + 1)) > 0;
+
+        if (can_drop)
+        {
+            texture_queue_job(texture_handle_of(victim), victim->dropped_levels + 1, victim->bytes - reduced);
+            projected -= victim->bytes - reduced;
+        }
+        else
+        {
+            projected -= victim->bytes;
+            texture_evict(victim);
+        }
+    }
+}
+
+void texture_system_init(int worker_count)
+{
+    my_assert(!textures.initialized, "texture system already initialized");
+
+    textures.pool = thread_pool_create(worker_count);
+    pthread_mutex_init(&textures.done_lock, NULL);
+    pthread_cond_init(&textures.done_signal, NULL);
+
+    textures.slots = malloc(sizeof(texture_t) * TEXTURE_INITIAL_CAPACITY);
+    my_assert(textures.slots, "failed to allocate texture slots");
+    textures.capacity = TEXTURE_INITIAL_CAPACITY;
+    textures.count = 0;
+
+    // 2x2 magenta/black checker so missing textures stand out
+    unsigned char checker[] = {
+        255, 0, 255, 255,   0, 0, 0, 255,
+        0, 0, 0, 255,       255, 0, 255, 255
+    };
+    glGenTextures(1, &textures.placeholder);
+    glBindTexture(GL_TEXTURE_2D, textures.placeholder);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, checker);
+    gl_check_error();
+
+    textures.initialized = true;
+    my_log(INFOMSG("texture system: %d decode workers\n"), thread_pool_size(textures.pool));
+}
+
+void texture_streaming_init(int slot_count, size_t slot_size)
+{
+    my_assert(textures.initialized, "texture_system_init() was not called");
+    my_assert(textures.ring == NULL, "texture streaming already initialized");
+
+    textures.ring = pbo_ring_create(slot_count, slot_size);
+    my_log(INFOMSG("texture streaming: %d pixel buffers of %zu bytes\n"), slot_count, slot_size);
+}
+
+void texture_system_shutdown(void)
+{
+    if (!textures.initialized)
+        return;
+
+    // let workers finish, then drop whatever was not uploaded yet
+    thread_pool_destroy(textures.pool);
+    textures.pool = NULL;
+
+    texture_job_t* lists[] = { textures.done, textures.waiting };
+    for (int i = 0; i < 2; i++)
+    {
+        for (texture_job_t* job = lists[i]; job != NULL;)
+        {
+            texture_job_t* next = job->next;
+            texture_job_release(job);
+            job = next;
+        }
+    }
+    textures.done = NULL;
+    textures.waiting = NULL;
+
+    // unmaps slots of jobs that were staged but never uploaded
+    pbo_ring_destroy(textures.ring);
+    textures.ring = NULL;
+
+    for (unsigned int i = 0; i < textures.count; i++)
+    {
+        if (textures.slots[i].id)
+            glDeleteTextures(1, &textures.slots[i].id);
+        free(textures.slots[i].path);
+    }
+    glDeleteTextures(1, &textures.placeholder);
+
+    free(textures.slots);
+    textures.slots = NULL;
+    textures.count = textures.capacity = 0;
+    textures.pending = 0;
+    textures.pending_savings = 0;
+
+    pthread_mutex_destroy(&textures.done_lock);
+    pthread_cond_destroy(&textures.done_signal);
+    textures.initialized = false;
+}
+
+texture_handle texture_load_async(const char* path, texture_params params)
+{
+    my_assert(textures.initialized, "texture_system_init() was not called");
+    for (int i = 0; i < 4; i++)
+        my_assert(params.swizzle[i] < 4, "texture swizzle selects a channel out of range");
+
+    // "./a.png" and "textures/../a.png" are the same image, missing files keep their spelling and fail in the decoder
+    char normalized[PATH_MAX];
+    if (realpath(path, normalized) == NULL)
+        snprintf(normalized, sizeof(normalized), "%s", path);
+    uint64_t hash = texture_cache_hash(normalized, strlen(normalized));
+
+    // shared handle for an image already loaded with the same params, otherwise the first free slot
+    texture_t* texture = NULL;
+    for (unsigned int i = 0; i < textures.count; i++)
+    {
+        texture_t* slot = &textures.slots[i];
+        if (slot->path == NULL)
+        {
+            if (texture == NULL && !slot->reloading)
+                texture = slot;
+        }
+        else if (slot->refs > 0 && slot->path_hash == hash && strcmp(slot->path, normalized) == 0 && texture_params_equal(&slot->params, &params))
+        {
+            slot->refs++;
+            return texture_handle_of(slot);
+        }
+    }
+
+    if (texture == NULL)
+    {
+        if (textures.count == textures.capacity)
+        {
+            textures.capacity *= 2;
+            textures.slots = realloc(textures.slots, sizeof(texture_t) * textures.capacity);
+            my_assert(textures.slots, "failed to grow texture slots");
+        }
+        my_assert(textures.count < TEXTURE_HANDLE_INDEX_MASK, "too many texture slots");
+        texture = &textures.slots[textures.count++];
+        texture->generation = 0;
+    }
+
+    *texture = (texture_t) {
+        .id = 0,
+        .state = TEXTURE_STATE_PENDING,
+        .params = params,
+        .path = strdup(normalized),
+        .path_hash = hash,
+        .refs = 1,
+        .generation = texture->generation,
+        .last_used = textures.frame
+    };
+
+    texture_handle handle = texture_handle_of(texture);
+    texture_queue_job(handle, 0, 0);
+    return handle;
+}
+
+void texture_release(texture_handle handle)
+{
+    texture_t* texture = texture_from_handle(handle);
+    if (texture == NULL || texture->refs == 0)
+        return;
+
+    // a job in flight still writes into the slot, it frees the texture when it lands
+    if (--texture->refs == 0 && !texture->reloading)
+        texture_free(texture);
+}
+
+/**
+ * uploads job through the ring when it fits
+ * returns false if the job has to wait for a free slot, or has progressive levels left
+ */
+static bool texture_process_job(texture_job_t* job, GLuint64 slot_timeout_ns)
+{
+    texture_t* texture = texture_from_handle(job->handle);
+
+    if (!texture_job_has_pixels(job))
+    {
+        // a failed reload keeps whatever is resident
+        if (texture->id == 0)
+            texture->state = TEXTURE_STATE_FAILED;
+        texture_reload_finished(texture);
+        my_log(ERRMSG("failed to load texture: ") PATHMSG("%s") " (%s)\n", job->path, job->failure_reason);
+    }
+    else if (job->staged)
+    {
+        pbo_ring_begin_upload(textures.ring, &job->slot);
+        texture_upload(texture, job, 0);
+        pbo_ring_end_upload(textures.ring, &job->slot);
+    }
+    else if (job->streaming || (job->params.progressive && texture->id == 0 && job->chain.level_count - job->first_level > 1))
+    {
+        // a reload keeps the old texture until the new one is complete, so it never streams
+        // released textures stop streaming right away
+        if (texture->refs > 0 && !texture_upload_progressive(texture, job))
+            return false;
+        texture_reload_finished(texture);
+    }
+    else if (textures.ring && texture_job_span(job, NULL) <= pbo_ring_slot_size(textures.ring))
+    {
+        if (!pbo_ring_acquire(textures.ring, &job->slot, slot_timeout_ns))
+            return false;
+
+        // copy into the mapping off the GL thread, upload happens when the job comes back
+        thread_pool_submit(textures.pool, texture_stage_job, job);
+        return true;
+    }
+    else
+    {
+        // no streaming or image larger than a slot: synchronous upload from client memory
+        size_t start;
+        texture_job_span(job, &start);
+        texture_upload(texture, job, (uintptr_t) (job->chain.data + start));
+    }
+
+    texture_job_release(job);
+    textures.pending--;
+
+    if (texture->refs == 0)
+        texture_free(texture);
+    return true;
+}
+
+static int texture_process(GLuint64 slot_timeout_ns)
+{
+    textures.progressive_bytes = TEXTURE_PROGRESSIVE_FRAME_BYTES;
+
+    pthread_mutex_lock(&textures.done_lock);
+    texture_job_t* done = textures.done;
+    textures.done = NULL;
+    pthread_mutex_unlock(&textures.done_lock);
+
+    // jobs that could not get a slot or still stream levels go first
+    texture_job_t** tail = &textures.waiting;
+    while (*tail != NULL)
+        tail = &(*tail)->next;
+    *tail = done;
+
+    texture_job_t* jobs = textures.waiting;
+    textures.waiting = NULL;
+    tail = &textures.waiting;
+
+    int changed = 0;
+    while (jobs != NULL)
+    {
+        texture_job_t* job = jobs;
+        jobs = job->next;
+        job->next = NULL;
+
+        int pending = textures.pending;
+        if (!texture_process_job(job, slot_timeout_ns))
+        {
+            *tail = job;
+            tail = &job->next;
+        }
+        else if (textures.pending != pending)
+        {
+            changed++;
+        }
+    }
+
+    return changed;
+}
+
+int texture_update(void)
+{
+    if (!textures.initialized)
+        return 0;
+
+    // never stall the frame on a busy slot
+    int changed = texture_process(0);
+    texture_enforce_budget();
+    textures.frame++;
+    return changed;
+}
+
+void texture_set_budget(size_t bytes)
+{
+    textures.budget = bytes;
+}
+
+size_t texture_get_resident_bytes(void)
+{
+    return textures.resident_bytes;
+}
+
+void texture_wait_all(void)
+{
+    while (textures.pending > 0)
+    {
+        if (textures.waiting == NULL)
+        {
+            pthread_mutex_lock(&textures.done_lock);
+            while (textures.done == NULL)
+                pthread_cond_wait(&textures.done_signal, &textures.done_lock);
+            pthread_mutex_unlock(&textures.done_lock);
+        }
+
+        texture_process(TEXTURE_STREAM_WAIT_NS);
+    }
+}
+
+texture_state texture_get_state(texture_handle handle)
+{
+    texture_t* texture = texture_from_handle(handle);
+    return texture ? texture->state : TEXTURE_STATE_FAILED;
+}
+
+GLuint texture_get_id(texture_handle handle)
+{
+    texture_t* texture = texture_from_handle(handle);
+    if (texture == NULL || texture->state != TEXTURE_STATE_READY)
+        return textures.placeholder;
+    return texture->id;
+}
+
+void texture_bind(texture_handle handle, unsigned int unit)
+{
+    texture_t* texture = texture_from_handle(handle);
+    if (texture)
+    {
+        texture->last_used = textures.frame;
+
+        // evicted textures come back on demand, degraded ones once the budget has room for them again
+        if (!texture->reloading)
+        {
+            if (texture->state == TEXTURE_STATE_EVICTED)
+                texture_queue_job(handle, texture->dropped_levels, 0);
+            else if (texture->dropped_levels > 0 && (textures.budget == 0 || textures.resident_bytes - texture->bytes + texture->full_bytes <= textures.budget))
+                texture_queue_job(handle, 0, 0);
+        }
+    }
+
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, texture_get_id(handle));
+}
@@ -0,0 +1,133 @@
+#ifndef __TEXTURE_H__
+#define __TEXTURE_H__
+
+#include <glad/glad.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// default streaming ring, fits a 1024x1024 RGBA image with its full mip chain per slot
+#define TEXTURE_STREAM_SLOTS     4
+#define TEXTURE_STREAM_SLOT_SIZE (6u * 1024 * 1024)
+
+// upload bandwidth of progressive textures per texture_update(), at least one level is always uploaded
+#define TEXTURE_PROGRESSIVE_FRAME_BYTES (1u * 1024 * 1024)
+
+// default GPU memory budget for texture residency
+#define TEXTURE_BUDGET_DEFAULT (256u * 1024 * 1024)
+
+// 0 is never handed out, handles start at 1
+// the high bits hold the generation of the slot, a handle released for good stops resolving once the slot is reused
+typedef unsigned int texture_handle;
+#define TEXTURE_INVALID_HANDLE 0
+
+typedef enum texture_state
+{
+    TEXTURE_STATE_PENDING,  // queued or decoding on a worker, placeholder is bound
+    TEXTURE_STATE_READY,    // uploaded to GL
+    TEXTURE_STATE_FAILED,   // decode failed, placeholder stays bound
+    TEXTURE_STATE_EVICTED   // dropped to stay in budget, placeholder is bound until texture_bind() reloads it
+} texture_state;
+
+typedef struct texture_params
+{
+    GLint wrap_s;
+    GLint wrap_t;
+    GLint min_filter;
+    GLint mag_filter;
+    bool flip_vertically;
+    bool generate_mipmaps;
+    // color channels are sRGB encoded, mip levels are filtered in linear light
+    bool srgb;
+    // keep decoded (and mipmapped) pixels in a .tcache file next to the source
+    bool use_cache;
+    // prefer a block compressed .ktx2 next to the source (see tools/texconv.c)
+    bool use_compressed;
+    // RGB images are uploaded as RGBA, 4 byte texels upload without row realignment
+    bool expand_rgb;
+    // channel i of the uploaded texel is channel swizzle[i] of the decoded one, e.g. {2, 1, 0, 3} for BGRA sources, entries are 0..3
+    // applied to RGBA images (RGB ones with expand_rgb) before premultiplication, {0, 1, 2, 3} leaves them alone
+    unsigned char swizzle[4];
+    // color multiplied by alpha before mips are built, for glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA)
+    bool premultiply_alpha;
+    // upload smallest mip levels first and the rest over following frames (TEXTURE_PROGRESSIVE_FRAME_BYTES per frame)
+    bool progressive;
+} texture_params;
+
+// repeat on both axes, trilinear filtering, flipped to GL's bottom-left origin,
+// precompressed file or disk cache when available
+#define TEXTURE_PARAMS_DEFAULT ((texture_params) { \
+    .wrap_s = GL_REPEAT, \
+    .wrap_t = GL_REPEAT, \
+    .min_filter = GL_LINEAR_MIPMAP_LINEAR, \
+    .mag_filter = GL_LINEAR, \
+    .flip_vertically = true, \
+    .generate_mipmaps = true, \
+    .srgb = false, \
+    .use_cache = true, \
+    .use_compressed = true, \
+    .expand_rgb = false, \
+    .swizzle = { 0, 1, 2, 3 }, \
+    .premultiply_alpha = false, \
+    .progressive = false })
+
+/**
+ * starts decode workers and creates placeholder texture, needs current GL context
+ * worker_count <= 0 uses one worker per core
+ */
+void texture_system_init(int worker_count);
+
+/**
+ * enables streaming uploads through a ring of slot_count pixel unpack buffers
+ * workers copy decoded pixels into mapped buffer memory and uploads are fenced per slot,
+ * images larger than slot_size keep the synchronous path
+ */
+void texture_streaming_init(int slot_count, size_t slot_size);
+
+/**
+ * joins workers and deletes every texture including the placeholder
+ */
+void texture_system_shutdown(void);
+
+/**
+ * queues image for decoding on a worker thread and returns immediately
+ * until the image is uploaded the handle resolves to the placeholder texture
+ * loading a path that is already loaded with the same params returns the same handle with one more reference
+ */
+texture_handle texture_load_async(const char* path, texture_params params);
+
+/**
+ * drops one reference, the GL texture is deleted with the last one and the handle becomes invalid
+ */
+void texture_release(texture_handle handle);
+
+/**
+ * uploads every image decoded since last call and applies the memory budget
+ * must run on the GL thread once per frame, it also advances the frame counter used for LRU
+ * returns number of textures that changed state
+ */
+int texture_update(void);
+
+/**
+ * GPU memory budget for all textures, 0 disables it (default)
+ * once per texture_update() the least recently bound textures over budget are reloaded
+ * without their top mip levels, and evicted if that is not enough
+ */
+void texture_set_budget(size_t bytes);
+
+size_t texture_get_resident_bytes(void);
+
+/**
+ * blocks until every queued texture is decoded and uploaded
+ */
+void texture_wait_all(void);
+
+texture_state texture_get_state(texture_handle handle);
+
+/**
+ * GL name of the texture or of the placeholder while it is not ready
+ */
+GLuint texture_get_id(texture_handle handle);
+
+void texture_bind(texture_handle handle, unsigned int unit);
+
+#endif // __TEXTURE_H__
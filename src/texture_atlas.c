@@ -0,0 +1,210 @@
+#include "texture_atlas.h"
+
+#include <limits.h>
+
+#include "./vendor/stb_image.h"
+
+#include "gl_ext.h"
+#include "pixel.h"
+#include "texture_atlas_pack.h"
+
+#define ENABLE_LOGS
+#include "debug.h"
+
+typedef struct texture_atlas_sprite
+{
+    char* path;
+    unsigned char* pixels; // RGBA, only alive during build
+} texture_atlas_sprite;
+
+struct texture_atlas
+{
+    texture_atlas_kind kind;
+    int page_size;
+    int padding;
+    int layers;
+    GLuint id;
+
+    texture_atlas_sprite* sprites;
+    texture_atlas_rect* rects;
+    texture_atlas_region* regions;
+    int count;
+    int capacity;
+};
+
+texture_atlas_t* texture_atlas_create(texture_atlas_kind kind, int page_size, int padding)
+{
+    texture_atlas_t* atlas = calloc(1, sizeof(texture_atlas_t));
+    my_assert(atlas, "failed to allocate texture atlas");
+
+    atlas->kind = kind;
+    atlas->page_size = page_size;
+    atlas->padding = padding;
+    return atlas;
+}
+
+void texture_atlas_destroy(texture_atlas_t* atlas)
+{
+    if (atlas == NULL)
+        return;
+
+    if (atlas->id)
+        glDeleteTextures(1, &atlas->id);
+
+    for (int i = 0; i < atlas->count; i++)
+    {
+        stbi_image_free(atlas->sprites[i].pixels);
+        free(atlas->sprites[i].path);
+    }
+    free(atlas->sprites);
+    free(atlas->rects);
+    free(atlas->regions);
+    free(atlas);
+}
+
+int texture_atlas_add(texture_atlas_t* atlas, const char* path)
+{
+    if (atlas->count == atlas->capacity)
+    {
+        atlas->capacity = atlas->capacity ? atlas->capacity * 2 : 16;
+        atlas->sprites = realloc(atlas->sprites, sizeof(texture_atlas_sprite) * atlas->capacity);
+        atlas->rects = realloc(atlas->rects, sizeof(texture_atlas_rect) * atlas->capacity);
+        atlas->regions = realloc(atlas->regions, sizeof(texture_atlas_region) * atlas->capacity);
+        my_assert(atlas->sprites && atlas->rects && atlas->regions, "failed to grow texture atlas");
+    }
+
+    atlas->sprites[atlas->count] = (texture_atlas_sprite) { .path = strdup(path) };
+    atlas->rects[atlas->count] = (texture_atlas_rect) {0};
+    atlas->regions[atlas->count] = (texture_atlas_region) {0};
+    return atlas->count++;
+}
+
+bool texture_atlas_build(texture_atlas_t* atlas, bool generate_mipmaps)
+{
+    for (int i = 0; i < atlas->count; i++)
+    {
+        texture_atlas_sprite* sprite = &atlas->sprites[i];
+        texture_atlas_rect* rect = &atlas->rects[i];
+        int channels;
+        sprite->pixels = stbi_load(sprite->path, &rect->width, &rect->height, &channels, 4);
+        if (sprite->pixels == NULL)
+        {
+            my_log(ERRMSG("failed to load sprite: ") PATHMSG("%s") " (%s)\n", sprite->path, stbi_failure_reason());
+            return false;
+        }
+
+        pixel_flip_vertical(sprite->pixels, rect->width, rect->height, 4);
+    }
+
+    // a 2D atlas has a single page
+    int failed = 0;
+    atlas->layers = texture_atlas_pack(atlas->rects, atlas->count, atlas->page_size, atlas->padding, atlas->kind == TEXTURE_ATLAS_2D ? 1 : INT_MAX, &failed);
+    if (atlas->layers < 0)
+    {
+        const texture_atlas_rect* rect = &atlas->rects[failed];
+        if (rect->width + 2 * atlas->padding > atlas->page_size || rect->height + 2 * atlas->padding > atlas->page_size)
+        {
+            my_log(ERRMSG("sprite does not fit atlas page: ") PATHMSG("%s\n"), atlas->sprites[failed].path);
+        }
+        else
+        {
+            my_log(ERRMSG("texture atlas is full at: ") PATHMSG("%s\n"), atlas->sprites[failed].path);
+        }
+        return false;
+    }
+
+    size_t page_bytes = (size_t) atlas->page_size * atlas->page_size * 4;
+    unsigned char* pages = calloc(atlas->layers, page_bytes);
+    my_assert(pages, "failed to allocate atlas pages");
+
+    float scale = 1.0f / atlas->page_size;
+    for (int i = 0; i < atlas->count; i++)
+    {
+        texture_atlas_sprite* sprite = &atlas->sprites[i];
+        const texture_atlas_rect* rect = &atlas->rects[i];
+        texture_atlas_blit(rect, sprite->pixels, atlas->padding, pages + rect->layer * page_bytes, atlas->page_size);
+
+        int x = rect->x + atlas->padding;
+        int y = rect->y + atlas->padding;
+        atlas->regions[i] = (texture_atlas_region) {
+            .u0 = x * scale,
+            .v0 = y * scale,
+            .u1 = (x + rect->width) * scale,
+            .v1 = (y + rect->height) * scale,
+            .layer = rect->layer
+        };
+
+        stbi_image_free(sprite->pixels);
+        sprite->pixels = NULL;
+    }
+
+    GLenum target = atlas->kind == TEXTURE_ATLAS_ARRAY ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+    // the chain stops where sprites would start to bleed into each other
+    int levels = generate_mipmaps ? texture_atlas_mip_levels(atlas->page_size, atlas->padding) : 1;
+    glGenTextures(1, &atlas->id);
+    glBindTexture(target, atlas->id);
+
+    // immutable storage when available, pages are then filled in without reallocation
+    if (target == GL_TEXTURE_2D_ARRAY && gl_ext.tex_storage_3d)
+    {
+        gl_ext.tex_storage_3d(target, levels, GL_RGBA8, atlas->page_size, atlas->page_size, atlas->layers);
+        glTexSubImage3D(target, 0, 0, 0, 0, atlas->page_size, atlas->page_size, atlas->layers, GL_RGBA, GL_UNSIGNED_BYTE, pages);
+    }
+    else if (target == GL_TEXTURE_2D_ARRAY)
+        glTexImage3D(target, 0, GL_RGBA8, atlas->page_size, atlas->page_size, atlas->layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, pages);
+    else if (gl_ext.tex_storage_2d)
+    {
+        gl_ext.tex_storage_2d(target, levels, GL_RGBA8, atlas->page_size, atlas->page_size);
+        glTexSubImage2D(target, 0, 0, 0, atlas->page_size, atlas->page_size, GL_RGBA, GL_UNSIGNED_BYTE, pages);
+    }
+    else
+        glTexImage2D(target, 0, GL_RGBA8, atlas->page_size, atlas->page_size, 0, GL_RGBA, GL_UNSIGNED_BYTE, pages);
+    gl_check_error();
+    free(pages);
+
+    // sprites must not wrap into their neighbours
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    if (levels > 1)
+        glGenerateMipmap(target);
+
+    my_log(INFOMSG("texture atlas: %d sprites in %d page(s) of %dx%d\n"), atlas->count, atlas->layers, atlas->page_size, atlas->page_size);
+    return true;
+}
+
+const texture_atlas_region* texture_atlas_get_region(const texture_atlas_t* atlas, int sprite)
+{
+    my_assert(sprite >= 0 && sprite < atlas->count, "sprite index out of range");
+    return &atlas->regions[sprite];
+}
+
+int texture_atlas_sprite_count(const texture_atlas_t* atlas)
+{
+    return atlas->count;
+}
+
+void texture_atlas_remap_uvs(const texture_atlas_t* atlas, int sprite, float* vertices, int vertex_count, int stride, int uv_offset)
+{
+    const texture_atlas_region* region = texture_atlas_get_region(atlas, sprite);
+
+    for (int i = 0; i < vertex_count; i++)
+    {
+        float* uv = vertices + i * stride + uv_offset;
+        uv[0] = region->u0 + uv[0] * (region->u1 - region->u0);
+        uv[1] = region->v0 + uv[1] * (region->v1 - region->v0);
+    }
+}
+
+void texture_atlas_bind(const texture_atlas_t* atlas, unsigned int unit)
+{
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(atlas->kind == TEXTURE_ATLAS_ARRAY ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D, atlas->id);
+}
+
+GLuint texture_atlas_get_id(const texture_atlas_t* atlas)
+{
+    return atlas->id;
+}
@@ -0,0 +1,57 @@
+#ifndef __TEXTURE_ATLAS_H__
+#define __TEXTURE_ATLAS_H__
+
+#include <glad/glad.h>
+#include <stdbool.h>
+
+typedef enum texture_atlas_kind
+{
+    TEXTURE_ATLAS_2D,    // one GL_TEXTURE_2D page, sample with sampler2D
+    TEXTURE_ATLAS_ARRAY  // pages are layers of a GL_TEXTURE_2D_ARRAY, sample with sampler2DArray
+} texture_atlas_kind;
+
+// where a sprite ended up, v0 is the bottom edge (sprites are flipped like regular textures)
+typedef struct texture_atlas_region
+{
+    float u0, v0;
+    float u1, v1;
+    int layer;
+} texture_atlas_region;
+
+typedef struct texture_atlas texture_atlas_t;
+
+/**
+ * page_size is the width and height of one page (2D atlas: the only page)
+ * padding is the border around each sprite filled with its edge texels, stops bleeding under bilinear filtering
+ */
+texture_atlas_t* texture_atlas_create(texture_atlas_kind kind, int page_size, int padding);
+
+void texture_atlas_destroy(texture_atlas_t* atlas);
+
+/**
+ * queues image for packing, returns sprite index used for texture_atlas_get_region()
+ */
+int texture_atlas_add(texture_atlas_t* atlas, const char* path);
+
+/**
+ * decodes queued images, packs them into shelves and uploads the pages (GL thread)
+ * fails when a sprite is larger than a page, or a 2D atlas runs out of room
+ * mipmaps stop at the level the padding still covers, no padding means no mipmaps
+ */
+bool texture_atlas_build(texture_atlas_t* atlas, bool generate_mipmaps);
+
+const texture_atlas_region* texture_atlas_get_region(const texture_atlas_t* atlas, int sprite);
+
+int texture_atlas_sprite_count(const texture_atlas_t* atlas);
+
+/**
+ * rewrites texture coordinates of an interleaved vertex array from 0..1 sprite space into atlas space
+ * stride and uv_offset are in floats, e.g. 8 and 6 for the position/color/uv layout in main.c
+ */
+void texture_atlas_remap_uvs(const texture_atlas_t* atlas, int sprite, float* vertices, int vertex_count, int stride, int uv_offset);
+
+void texture_atlas_bind(const texture_atlas_t* atlas, unsigned int unit);
+
+GLuint texture_atlas_get_id(const texture_atlas_t* atlas);
+
+#endif // __TEXTURE_ATLAS_H__
@@ -0,0 +1,99 @@
+#include "texture_atlas_pack.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ENABLE_LOGS
+#include "debug.h"
+
+static int texture_atlas_compare_height(const void* a, const void* b)
+{
+    const texture_atlas_rect* ra = *(const texture_atlas_rect* const*) a;
+    const texture_atlas_rect* rb = *(const texture_atlas_rect* const*) b;
+    if (ra->height != rb->height)
+        return rb->height - ra->height;
+    return rb->width - ra->width;
+}
+
+int texture_atlas_pack(texture_atlas_rect* rects, int count, int page_size, int padding, int max_layers, int* failed)
+{
+    texture_atlas_rect** order = malloc(sizeof(texture_atlas_rect*) * (count > 0 ? count : 1));
+    my_assert(order, "failed to allocate atlas packing order");
+    for (int i = 0; i < count; i++)
+        order[i] = &rects[i];
+    qsort(order, count, sizeof(texture_atlas_rect*), texture_atlas_compare_height);
+
+    int layer = 0, shelf_y = 0, shelf_height = 0, cursor_x = 0;
+    int layers = 1;
+
+    for (int i = 0; i < count; i++)
+    {
+        texture_atlas_rect* rect = order[i];
+        int width = rect->width + 2 * padding;
+        int height = rect->height + 2 * padding;
+
+        // next shelf
+        if (cursor_x + width > page_size)
+        {
+            shelf_y += shelf_height;
+            shelf_height = 0;
+            cursor_x = 0;
+        }
+
+        // next page
+        if (shelf_y + height > page_size)
+        {
+            layer++;
+            shelf_y = 0;
+            shelf_height = 0;
+            cursor_x = 0;
+        }
+
+        if (width > page_size || height > page_size || layer >= max_layers)
+        {
+            *failed = (int) (rect - rects);
+            layers = -1;
+            break;
+        }
+
+        rect->x = cursor_x;
+        rect->y = shelf_y;
+        rect->layer = layer;
+
+        cursor_x += width;
+        shelf_height = height > shelf_height ? height : shelf_height;
+        layers = layer + 1;
+    }
+
+    free(order);
+    return layers;
+}
+
+void texture_atlas_blit(const texture_atlas_rect* rect, const unsigned char* pixels, int padding, unsigned char* page, int page_size)
+{
+    int padded_width = rect->width + 2 * padding;
+    int padded_height = rect->height + 2 * padding;
+
+    for (int y = 0; y < padded_height; y++)
+    {
+        int sy = y - padding;
+        sy = sy < 0 ? 0 : (sy >= rect->height ? rect->height - 1 : sy);
+        unsigned char* dst = page + ((size_t) (rect->y + y) * page_size + rect->x) * 4;
+        const unsigned char* src = pixels + (size_t) sy * rect->width * 4;
+
+        for (int x = 0; x < padding; x++)
+            memcpy(dst + x * 4, src, 4);
+        memcpy(dst + padding * 4, src, (size_t) rect->width * 4);
+        for (int x = padding + rect->width; x < padded_width; x++)
+            memcpy(dst + x * 4, src + (rect->width - 1) * 4, 4);
+    }
+}
+
+int texture_atlas_mip_levels(int page_size, int padding)
+{
+    // level n averages 2^n texels, that still reads only padding while 2^n <= padding
+    int levels = 1;
+    while ((1 << levels) <= padding && (page_size >> levels) > 0)
+        levels++;
+    return levels;
+}
@@ -0,0 +1,30 @@
+#ifndef __TEXTURE_ATLAS_PACK_H__
+#define __TEXTURE_ATLAS_PACK_H__
+
+// placement of one sprite, x and y are the top left of its padded area
+typedef struct texture_atlas_rect
+{
+    int width;
+    int height;
+    int x;
+    int y;
+    int layer;
+} texture_atlas_rect;
+
+/**
+ * shelf packing of rects sorted by height, tallest first, pages are filled up to max_layers
+ * returns the number of pages used, or -1 with failed set to the first rect that found no room
+ */
+int texture_atlas_pack(texture_atlas_rect* rects, int count, int page_size, int padding, int max_layers, int* failed);
+
+/**
+ * copies RGBA pixels of a packed rect into its page and extrudes edge texels into the padding
+ */
+void texture_atlas_blit(const texture_atlas_rect* rect, const unsigned char* pixels, int padding, unsigned char* page, int page_size);
+
+/**
+ * mip levels that stay inside the padding, deeper levels would average neighbouring sprites together
+ */
+int texture_atlas_mip_levels(int page_size, int padding);
+
+#endif // __TEXTURE_ATLAS_PACK_H__
@@ -0,0 +1,185 @@
+#include "texture_cache.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "utils.h"
+
+#define ENABLE_LOGS
+#include "debug.h"
+
+#define TEXTURE_CACHE_MAGIC   0x31435854u // "TXC1"
+#define TEXTURE_CACHE_VERSION 1u
+// level data starts aligned so SIMD consumers can read straight from the mapping
+#define TEXTURE_CACHE_ALIGNMENT 16
+
+typedef struct texture_cache_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t source_hash;
+    uint32_t flags;
+    uint32_t channels;
+    uint32_t level_count;
+    uint32_t reserved;
+} texture_cache_header;
+
+typedef struct texture_cache_level
+{
+    uint64_t offset; // from start of file
+    uint64_t size;
+    uint32_t width;
+    uint32_t height;
+} texture_cache_level;
+
+uint64_t texture_cache_hash(const void* data, size_t size)
+{
+    return hash_fnv1a(data, size, HASH_FNV1A_SEED);
+}
+
+void texture_cache_path(const char* source_path, char* out, size_t out_size)
+{
+    snprintf(out, out_size, "%s" TEXTURE_CACHE_EXTENSION, source_path);
+}
+
+bool texture_cache_map(const char* cache_path, uint64_t source_hash, uint32_t flags, texture_cache_mapping* mapping)
+{
+    memset(mapping, 0, sizeof(texture_cache_mapping));
+
+    int fd = open(cache_path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(texture_cache_header))
+    {
+        close(fd);
+        return false;
+    }
+
+    size_t size = st.st_size;
+    void* base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return false;
+
+    const texture_cache_header* header = base;
+    bool valid = header->magic == TEXTURE_CACHE_MAGIC
+              && header->version == TEXTURE_CACHE_VERSION
+              && header->source_hash == source_hash
+              && header->flags == flags
+              && header->level_count >= 1 && header->level_count <= MIPMAP_MAX_LEVELS
+              && header->channels >= 1 && header->channels <= 4
+              && sizeof(texture_cache_header) + header->level_count * sizeof(texture_cache_level) <= size;
+
+    if (valid)
+    {
+        const texture_cache_level* levels = (const texture_cache_level*) (header + 1);
+        mip_chain* chain = &mapping->chain;
+        chain->data = base;
+        chain->size = size;
+        chain->channels = header->channels;
+        chain->level_count = header->level_count;
+
+        for (uint32_t i = 0; i < header->level_count && valid; i++)
+        {
+            valid = levels[i].offset <= size && levels[i].size <= size - levels[i].offset
+                 && levels[i].size == (uint64_t) levels[i].width * levels[i].height * header->channels;
+
+            chain->levels[i] = (mip_level) {
+                .offset = levels[i].offset,
+                .size = levels[i].size,
+                .width = levels[i].width,
+                .height = levels[i].height
+            };
+        }
+    }
+
+    if (!valid)
+    {
+        munmap(base, size);
+        memset(mapping, 0, sizeof(texture_cache_mapping));
+        return false;
+    }
+
+    // levels are uploaded right after this, start paging them in
+    madvise(base, size, MADV_WILLNEED);
+
+    mapping->base = base;
+    mapping->size = size;
+    return true;
+}
+
+void texture_cache_unmap(texture_cache_mapping* mapping)
+{
+    if (mapping->base)
+        munmap(mapping->base, mapping->size);
+    memset(mapping, 0, sizeof(texture_cache_mapping));
+}
+
+bool texture_cache_store(const char* cache_path, uint64_t source_hash, uint32_t flags, const mip_chain* chain)
+{
+    char tmp_path[4096];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.XXXXXX", cache_path);
+
+    int fd = mkstemp(tmp_path);
+    if (fd < 0)
+        return false;
+    // mkstemp creates 0600, cache is as readable as the source next to it
+    fchmod(fd, 0644);
+
+    FILE* f = fdopen(fd, "wb");
+    if (f == NULL)
+    {
+        close(fd);
+        unlink(tmp_path);
+        return false;
+    }
+
+    texture_cache_header header = {
+        .magic = TEXTURE_CACHE_MAGIC,
+        .version = TEXTURE_CACHE_VERSION,
+        .source_hash = source_hash,
+        .flags = flags,
+        .channels = chain->channels,
+        .level_count = chain->level_count
+    };
+
+    size_t data_start = sizeof(header) + chain->level_count * sizeof(texture_cache_level);
+    data_start = (data_start + TEXTURE_CACHE_ALIGNMENT - 1) & ~(size_t) (TEXTURE_CACHE_ALIGNMENT - 1);
+
+    texture_cache_level levels[MIPMAP_MAX_LEVELS];
+    for (int i = 0; i < chain->level_count; i++)
+    {
+        levels[i] = (texture_cache_level) {
+            .offset = data_start + chain->levels[i].offset,
+            .size = chain->levels[i].size,
+            .width = chain->levels[i].width,
+            .height = chain->levels[i].height
+        };
+    }
+
+    static const unsigned char padding[TEXTURE_CACHE_ALIGNMENT] = {0};
+    size_t header_size = sizeof(header) + chain->level_count * sizeof(texture_cache_level);
+
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1
+           && fwrite(levels, sizeof(texture_cache_level), chain->level_count, f) == (size_t) chain->level_count
+           && fwrite(padding, 1, data_start - header_size, f) == data_start - header_size
+           && fwrite(chain->data, 1, chain->size, f) == chain->size;
+
+    ok = fclose(f) == 0 && ok;
+    if (ok)
+        ok = rename(tmp_path, cache_path) == 0;
+
+    if (!ok)
+    {
+        unlink(tmp_path);
+        my_log(WARRMSG("failed to write texture cache: ") PATHMSG("%s\n"), cache_path);
+    }
+
+    return ok;
+}
@@ -0,0 +1,53 @@
+#ifndef __TEXTURE_CACHE_H__
+#define __TEXTURE_CACHE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mipmap.h"
+
+// cache files sit next to their source image: awesomeface.png -> awesomeface.png.tcache
+#define TEXTURE_CACHE_EXTENSION ".tcache"
+
+// flags describing how the cached pixels were produced, must match on load
+#define TEXTURE_CACHE_FLIPPED   (1u << 0)
+#define TEXTURE_CACHE_MIPMAPPED (1u << 1)
+#define TEXTURE_CACHE_SRGB      (1u << 2)
+#define TEXTURE_CACHE_PREMULTIPLIED (1u << 3)
+#define TEXTURE_CACHE_EXPANDED      (1u << 4)
+// non-identity swizzle, 2 bits per channel from bit 8
+#define TEXTURE_CACHE_SWIZZLE_SHIFT 8
+
+// read-only mapping of a cache file, chain.data points into the mapping
+typedef struct texture_cache_mapping
+{
+    mip_chain chain;
+    void* base;
+    size_t size;
+} texture_cache_mapping;
+
+/**
+ * 64-bit FNV-1a of the source file contents
+ */
+uint64_t texture_cache_hash(const void* data, size_t size);
+
+/**
+ * writes cache file path for given source into out
+ */
+void texture_cache_path(const char* source_path, char* out, size_t out_size);
+
+/**
+ * maps cache file and validates it against source hash and flags
+ * returns false on any mismatch so caller falls back to decoding
+ */
+bool texture_cache_map(const char* cache_path, uint64_t source_hash, uint32_t flags, texture_cache_mapping* mapping);
+
+void texture_cache_unmap(texture_cache_mapping* mapping);
+
+/**
+ * writes chain to cache file, goes through a temporary file so readers never see partial data
+ */
+bool texture_cache_store(const char* cache_path, uint64_t source_hash, uint32_t flags, const mip_chain* chain);
+
+#endif // __TEXTURE_CACHE_H__
@@ -0,0 +1,143 @@
+#include "thread_pool.h"
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "debug.h"
+
+typedef struct thread_pool_job
+{
+    thread_pool_job_fn fn;
+    void* arg;
+    struct thread_pool_job* next;
+} thread_pool_job_t;
+
+struct thread_pool
+{
+    pthread_t* threads;
+    int thread_count;
+
+    pthread_mutex_t lock;
+    // signaled when a job is queued or the pool is shutting down
+    pthread_cond_t job_available;
+    // signaled when the last running job finishes
+    pthread_cond_t idle;
+
+    thread_pool_job_t* head;
+    thread_pool_job_t* tail;
+    int running;
+    bool stop;
+};
+
+static void* thread_pool_worker(void* arg)
+{
+    thread_pool_t* pool = arg;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->head == NULL && !pool->stop)
+            pthread_cond_wait(&pool->job_available, &pool->lock);
+
+        // queue is drained before the worker leaves
+        if (pool->head == NULL && pool->stop)
+        {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+
+        thread_pool_job_t* job = pool->head;
+        pool->head = job->next;
+        if (pool->head == NULL)
+            pool->tail = NULL;
+        pool->running++;
+        pthread_mutex_unlock(&pool->lock);
+
+        job->fn(job->arg);
+        free(job);
+
+        pthread_mutex_lock(&pool->lock);
+        pool->running--;
+        if (pool->running == 0 && pool->head == NULL)
+            pthread_cond_broadcast(&pool->idle);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+thread_pool_t* thread_pool_create(int thread_count)
+{
+    if (thread_count <= 0)
+    {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = cores > 0 ? (int) cores : 1;
+    }
+
+    thread_pool_t* pool = calloc(1, sizeof(thread_pool_t));
+    my_assert(pool, "failed to allocate thread pool");
+
+    pool->threads = malloc(sizeof(pthread_t) * thread_count);
+    my_assert(pool->threads, "failed to allocate thread pool workers");
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->job_available, NULL);
+    pthread_cond_init(&pool->idle, NULL);
+
+    for (int i = 0; i < thread_count; i++)
+    {
+        my_assert(pthread_create(&pool->threads[i], NULL, thread_pool_worker, pool) == 0, "failed to spawn worker thread");
+    }
+    pool->thread_count = thread_count;
+
+    return pool;
+}
+
+void thread_pool_submit(thread_pool_t* pool, thread_pool_job_fn job, void* arg)
+{
+    thread_pool_job_t* node = malloc(sizeof(thread_pool_job_t));
+    my_assert(node, "failed to allocate thread pool job");
+    node->fn = job;
+    node->arg = arg;
+    node->next = NULL;
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->tail)
+        pool->tail->next = node;
+    else
+        pool->head = node;
+    pool->tail = node;
+    pthread_cond_signal(&pool->job_available);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void thread_pool_wait(thread_pool_t* pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    while (pool->head != NULL || pool->running > 0)
+        pthread_cond_wait(&pool->idle, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void thread_pool_destroy(thread_pool_t* pool)
+{
+    if (pool == NULL)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->job_available);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->thread_count; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->job_available);
+    pthread_cond_destroy(&pool->idle);
+    free(pool->threads);
+    free(pool);
+}
+
+int thread_pool_size(const thread_pool_t* pool)
+{
+    return pool->thread_count;
+}
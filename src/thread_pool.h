@@ -0,0 +1,33 @@
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+
+#include <stdbool.h>
+
+// job executed on one of the worker threads
+typedef void (*thread_pool_job_fn)(void* arg);
+
+typedef struct thread_pool thread_pool_t;
+
+/**
+ * spawns worker threads, thread_count <= 0 uses one worker per online core
+ */
+thread_pool_t* thread_pool_create(int thread_count);
+
+/**
+ * queues job for execution, jobs are picked up in FIFO order
+ */
+void thread_pool_submit(thread_pool_t* pool, thread_pool_job_fn job, void* arg);
+
+/**
+ * blocks until the queue is empty and no worker is running a job
+ */
+void thread_pool_wait(thread_pool_t* pool);
+
+/**
+ * finishes queued jobs, joins workers and frees the pool
+ */
+void thread_pool_destroy(thread_pool_t* pool);
+
+int thread_pool_size(const thread_pool_t* pool);
+
+#endif // __THREAD_POOL_H__
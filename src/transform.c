@@ -0,0 +1,50 @@
+#include "transform.h"
+
+#include <pthread.h>
+
+#include "shader_reflection.h"
+#include "transform_kernels.h"
+
+static struct
+{
+    pthread_once_t once;
+    transform_mvp_fn mvp_batch;
+    transform_normal_fn normal_batch;
+} transform = { .once = PTHREAD_ONCE_INIT };
+
+static void transform_init_once(void)
+{
+    // the fastest level this CPU supports
+    const transform_kernel* kernels;
+    int count = transform_kernels_available(&kernels);
+    transform.mvp_batch = kernels[count - 1].mvp_batch;
+    transform.normal_batch = kernels[count - 1].normal_batch;
+}
+
+void transform_mvp_batch(const float* view_projection, const float* models, float* out, size_t count)
+{
+    pthread_once(&transform.once, transform_init_once);
+    transform.mvp_batch(view_projection, models, out, count);
+}
+
+void transform_mat4_mul(const float* a, const float* b, float* out)
+{
+    transform_mvp_batch(a, b, out, 1);
+}
+
+void transform_normal_batch(const float* models, float* normals, size_t count)
+{
+    pthread_once(&transform.once, transform_init_once);
+    transform.normal_batch(models, normals, count);
+}
+
+void transform_upload(GLuint program, const float* mvp, const float* normal_matrix)
+{
+    GLint location = shader_uniform_location(program, SHADER_UNIFORM_MVP);
+    if (location >= 0)
+        glUniformMatrix4fv(location, 1, GL_FALSE, mvp);
+
+    location = shader_uniform_location(program, SHADER_UNIFORM_NORMAL_MATRIX);
+    if (location >= 0 && normal_matrix)
+        glUniformMatrix3fv(location, 1, GL_FALSE, normal_matrix);
+}
@@ -0,0 +1,35 @@
+#ifndef __TRANSFORM_H__
+#define __TRANSFORM_H__
+
+#include <glad/glad.h>
+#include <stddef.h>
+
+/**
+ * per object matrices computed on the CPU once per frame instead of once per vertex
+ * matrices are column major float[16] (mat4) and float[9] (mat3) like cglm's, stored back to back
+ * kernels are picked at runtime (scalar, SSE2, AVX + FMA)
+ */
+
+/**
+ * out[i] = view_projection * models[i], out may be models
+ */
+void transform_mvp_batch(const float* view_projection, const float* models, float* out, size_t count);
+
+/**
+ * out = a * b, out must not overlap a
+ */
+void transform_mat4_mul(const float* a, const float* b, float* out);
+
+/**
+ * normal matrices (inverse transpose of the upper 3x3) of models, needed only when the model scales non-uniformly
+ * singular models get a zero matrix
+ */
+void transform_normal_batch(const float* models, float* normals, size_t count);
+
+/**
+ * sets mvp and normal_matrix uniforms of the program in use, normal_matrix may be NULL
+ * locations come from the reflection table, uniforms the program does not use are skipped
+ */
+void transform_upload(GLuint program, const float* mvp, const float* normal_matrix);
+
+#endif // __TRANSFORM_H__
@@ -0,0 +1,173 @@
+#include "transform_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TRANSFORM_X86
+#include <immintrin.h>
+#endif
+
+#pragma region scalar
+static void transform_mvp_batch_scalar(const float* view_projection, const float* models, float* out, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        const float* model = models + i * 16;
+        for (int col = 0; col < 4; col++)
+        {
+            // the whole column is read before it is written, so out may be models
+            float column[4];
+            for (int row = 0; row < 4; row++)
+            {
+                float sum = 0.0f;
+                for (int k = 0; k < 4; k++)
+                    sum += view_projection[k * 4 + row] * model[col * 4 + k];
+                column[row] = sum;
+            }
+            for (int row = 0; row < 4; row++)
+                out[i * 16 + col * 4 + row] = column[row];
+        }
+    }
+}
+
+static inline void transform_cross(const float* a, const float* b, float* out)
+{
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+/**
+ * with model columns a, b, c the inverse transpose is (b x c, c x a, a x b) / det
+ */
+static void transform_normal_batch_scalar(const float* models, float* normals, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        const float* a = models + i * 16;
+        const float* b = a + 4;
+        const float* c = a + 8;
+
+        float cofactors[9];
+        transform_cross(b, c, cofactors + 0);
+        transform_cross(c, a, cofactors + 3);
+        transform_cross(a, b, cofactors + 6);
+
+        float det = a[0] * cofactors[0] + a[1] * cofactors[1] + a[2] * cofactors[2];
+        float inv_det = det != 0.0f ? 1.0f / det : 0.0f;
+        for (int k = 0; k < 9; k++)
+            normals[i * 9 + k] = cofactors[k] * inv_det;
+    }
+}
+#pragma endregion
+
+#ifdef TRANSFORM_X86
+#pragma region SSE2
+/**
+ * one column per iteration, a linear combination of view_projection's columns
+ */
+static void transform_mvp_batch_sse2(const float* view_projection, const float* models, float* out, size_t count)
+{
+    const __m128 c0 = _mm_loadu_ps(view_projection + 0);
+    const __m128 c1 = _mm_loadu_ps(view_projection + 4);
+    const __m128 c2 = _mm_loadu_ps(view_projection + 8);
+    const __m128 c3 = _mm_loadu_ps(view_projection + 12);
+
+    for (size_t i = 0; i < count * 4; i++)
+    {
+        __m128 m = _mm_loadu_ps(models + i * 4);
+        __m128 r = _mm_mul_ps(c0, _mm_shuffle_ps(m, m, _MM_SHUFFLE(0, 0, 0, 0)));
+        r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1))));
+        r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 2, 2, 2))));
+        r = _mm_add_ps(r, _mm_mul_ps(c3, _mm_shuffle_ps(m, m, _MM_SHUFFLE(3, 3, 3, 3))));
+        _mm_storeu_ps(out + i * 4, r);
+    }
+}
+
+/**
+ * a x b on xyz lanes, w comes out 0
+ */
+static inline __m128 transform_cross_sse2(__m128 a, __m128 b)
+{
+    __m128 a_yzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 b_yzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 t = _mm_sub_ps(_mm_mul_ps(a, b_yzx), _mm_mul_ps(a_yzx, b));
+    return _mm_shuffle_ps(t, t, _MM_SHUFFLE(3, 0, 2, 1));
+}
+
+static void transform_normal_batch_sse2(const float* models, float* normals, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        __m128 a = _mm_loadu_ps(models + i * 16 + 0);
+        __m128 b = _mm_loadu_ps(models + i * 16 + 4);
+        __m128 c = _mm_loadu_ps(models + i * 16 + 8);
+
+        __m128 bc = transform_cross_sse2(b, c);
+        __m128 ca = transform_cross_sse2(c, a);
+        __m128 ab = transform_cross_sse2(a, b);
+
+        // w of bc is 0, so the horizontal sum is the 3D dot product
+        __m128 d = _mm_mul_ps(a, bc);
+        d = _mm_add_ps(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(2, 3, 0, 1)));
+        d = _mm_add_ps(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(1, 0, 3, 2)));
+        float det = _mm_cvtss_f32(d);
+        __m128 inv_det = _mm_set1_ps(det != 0.0f ? 1.0f / det : 0.0f);
+
+        // columns are 3 floats apart, each store spills into the next column before it is written,
+        // the last one is stored as 2 + 1 floats to stay inside normals
+        float* n = normals + i * 9;
+        _mm_storeu_ps(n + 0, _mm_mul_ps(bc, inv_det));
+        _mm_storeu_ps(n + 3, _mm_mul_ps(ca, inv_det));
+        __m128 last = _mm_mul_ps(ab, inv_det);
+        _mm_storel_pi((__m64*) (n + 6), last);
+        _mm_store_ss(n + 8, _mm_movehl_ps(last, last));
+    }
+}
+#pragma endregion
+
+#pragma region AVX
+/**
+ * two columns per iteration, view_projection is repeated in both 128-bit lanes
+ * and the in-lane permute broadcasts a model element within its column
+ */
+__attribute__((target("avx,fma")))
+static void transform_mvp_batch_avx_fma(const float* view_projection, const float* models, float* out, size_t count)
+{
+    const __m256 c0 = _mm256_broadcast_ps((const __m128*) (view_projection + 0));
+    const __m256 c1 = _mm256_broadcast_ps((const __m128*) (view_projection + 4));
+    const __m256 c2 = _mm256_broadcast_ps((const __m128*) (view_projection + 8));
+    const __m256 c3 = _mm256_broadcast_ps((const __m128*) (view_projection + 12));
+
+    for (size_t i = 0; i < count * 2; i++)
+    {
+        __m256 m = _mm256_loadu_ps(models + i * 8);
+        __m256 r = _mm256_mul_ps(c0, _mm256_permute_ps(m, _MM_SHUFFLE(0, 0, 0, 0)));
+        r = _mm256_fmadd_ps(c1, _mm256_permute_ps(m, _MM_SHUFFLE(1, 1, 1, 1)), r);
+        r = _mm256_fmadd_ps(c2, _mm256_permute_ps(m, _MM_SHUFFLE(2, 2, 2, 2)), r);
+        r = _mm256_fmadd_ps(c3, _mm256_permute_ps(m, _MM_SHUFFLE(3, 3, 3, 3)), r);
+        _mm256_storeu_ps(out + i * 8, r);
+    }
+}
+#pragma endregion
+#endif // TRANSFORM_X86
+
+static const transform_kernel transform_kernels[] = {
+    { "scalar", transform_mvp_batch_scalar, transform_normal_batch_scalar },
+#ifdef TRANSFORM_X86
+    { "SSE2", transform_mvp_batch_sse2, transform_normal_batch_sse2 },
+    { "AVX+FMA", transform_mvp_batch_avx_fma, transform_normal_batch_sse2 },
+#endif
+};
+
+int transform_kernels_available(const transform_kernel** kernels)
+{
+    *kernels = transform_kernels;
+
+    int count = 1;
+#ifdef TRANSFORM_X86
+    count++;
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx") && __builtin_cpu_supports("fma"))
+        count++;
+#endif
+    return count;
+}
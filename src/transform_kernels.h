@@ -0,0 +1,23 @@
+#ifndef __TRANSFORM_KERNELS_H__
+#define __TRANSFORM_KERNELS_H__
+
+#include <stddef.h>
+
+typedef void (*transform_mvp_fn)(const float* view_projection, const float* models, float* out, size_t count);
+typedef void (*transform_normal_fn)(const float* models, float* normals, size_t count);
+
+// one instruction set level, a level without a normal kernel of its own reuses the one below
+typedef struct transform_kernel
+{
+    const char* name;
+    transform_mvp_fn mvp_batch;
+    transform_normal_fn normal_batch;
+} transform_kernel;
+
+/**
+ * kernels this CPU can run, the scalar reference first and the fastest last
+ * returns their count, transform.c dispatches to the last one
+ */
+int transform_kernels_available(const transform_kernel** kernels);
+
+#endif // __TRANSFORM_KERNELS_H__
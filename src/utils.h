@@ -0,0 +1,23 @@
+#ifndef __UTILS_H__
+#define __UTILS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HASH_FNV1A_SEED 0xcbf29ce484222325ull
+
+/**
+ * 64-bit FNV-1a, pass the previous result as hash to continue over several buffers
+ */
+static inline uint64_t hash_fnv1a(const void* data, size_t size, uint64_t hash)
+{
+    const unsigned char* bytes = data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+#endif // __UTILS_H__
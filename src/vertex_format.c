@@ -0,0 +1,282 @@
+#include "vertex_format.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "shader_reflection.h"
+
+typedef struct vertex_layout
+{
+    GLsizei stride;
+    size_t position;
+    size_t normal;
+    size_t color;
+    size_t texcoord;
+} vertex_layout;
+
+static vertex_layout vertex_format_layout(vertex_format format)
+{
+    static const GLsizei position_sizes[] = { [VERTEX_POSITION_FLOAT] = 12, [VERTEX_POSITION_HALF] = 8, [VERTEX_POSITION_UNORM16] = 8 };
+    static const GLsizei normal_sizes[] = { [VERTEX_NORMAL_NONE] = 0, [VERTEX_NORMAL_FLOAT] = 12, [VERTEX_NORMAL_OCTAHEDRAL] = 4 };
+    static const GLsizei color_sizes[] = { [VERTEX_COLOR_NONE] = 0, [VERTEX_COLOR_FLOAT] = 12, [VERTEX_COLOR_UNORM8] = 4 };
+    static const GLsizei texcoord_sizes[] = { [VERTEX_TEXCOORD_NONE] = 0, [VERTEX_TEXCOORD_FLOAT] = 8, [VERTEX_TEXCOORD_HALF] = 4, [VERTEX_TEXCOORD_UNORM16] = 4 };
+
+    vertex_layout layout = { 0 };
+    layout.position = layout.stride;
+    layout.stride += position_sizes[format.position];
+    layout.normal = layout.stride;
+    layout.stride += normal_sizes[format.normal];
+    layout.color = layout.stride;
+    layout.stride += color_sizes[format.color];
+    layout.texcoord = layout.stride;
+    layout.stride += texcoord_sizes[format.texcoord];
+    return layout;
+}
+
+GLsizei vertex_format_stride(vertex_format format)
+{
+    return vertex_format_layout(format).stride;
+}
+
+vertex_format vertex_format_fit(vertex_format format, const vertex_source* source, size_t count)
+{
+    if (source->texcoords == NULL || format.texcoord == VERTEX_TEXCOORD_NONE || format.texcoord == VERTEX_TEXCOORD_FLOAT)
+        return format;
+
+    float min = 0.0f;
+    float max = 0.0f;
+    for (size_t i = 0; i < count; i++)
+    {
+        const float* texcoord = source->texcoords + i * source->stride;
+        for (int k = 0; k < 2; k++)
+        {
+            min = texcoord[k] < min ? texcoord[k] : min;
+            max = texcoord[k] > max ? texcoord[k] : max;
+        }
+    }
+
+    if (format.texcoord == VERTEX_TEXCOORD_UNORM16 && (min < 0.0f || max > 1.0f))
+        format.texcoord = VERTEX_TEXCOORD_HALF;
+    if (format.texcoord == VERTEX_TEXCOORD_HALF && (min < -VERTEX_HALF_TEXCOORD_LIMIT || max > VERTEX_HALF_TEXCOORD_LIMIT))
+        format.texcoord = VERTEX_TEXCOORD_FLOAT;
+    return format;
+}
+
+#pragma region encoding
+static inline float vertex_clamp(float value, float min, float max)
+{
+    return value < min ? min : value > max ? max : value;
+}
+
+/**
+ * IEEE half, rounded to nearest even, out of range values become infinity
+ */
+static uint16_t vertex_half_from_float(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign = (bits >> 16) & 0x8000;
+    uint32_t magnitude = bits & 0x7fffffff;
+
+    // 65536 and up, infinity and NaN
+    if (magnitude >= 0x47800000)
+        return sign | (magnitude > 0x7f800000 ? 0x7e00 : 0x7c00);
+
+    // below the smallest normal half 2^-14 the mantissa is the value in units of 2^-24
+    if (magnitude < 0x38800000)
+    {
+        float absolute;
+        memcpy(&absolute, &magnitude, sizeof(absolute));
+        return sign | (uint16_t) lrintf(absolute * 16777216.0f);
+    }
+
+    // rebias the exponent from 127 to 15, a carry out of the mantissa bumps the exponent as it should
+    uint32_t half = (magnitude - 0x38000000) >> 13;
+    uint32_t rest = magnitude & 0x1fff;
+    half += rest > 0x1000 || (rest == 0x1000 && (half & 1));
+    return sign | (uint16_t) half;
+}
+
+static inline uint16_t vertex_unorm16(float value)
+{
+    return (uint16_t) lrintf(vertex_clamp(value, 0.0f, 1.0f) * 65535.0f);
+}
+
+static inline uint8_t vertex_unorm8(float value)
+{
+    return (uint8_t) lrintf(vertex_clamp(value, 0.0f, 1.0f) * 255.0f);
+}
+
+/**
+ * unit vector projected onto the octahedron |x| + |y| + |z| = 1, the lower half folded over the diagonals
+ */
+static void vertex_octahedral_encode(const float* normal, int16_t* out)
+{
+    float length = fabsf(normal[0]) + fabsf(normal[1]) + fabsf(normal[2]);
+    float x = length > 0.0f ? normal[0] / length : 0.0f;
+    float y = length > 0.0f ? normal[1] / length : 0.0f;
+    if (normal[2] < 0.0f)
+    {
+        float folded_x = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        y = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = folded_x;
+    }
+    out[0] = (int16_t) lrintf(vertex_clamp(x, -1.0f, 1.0f) * 32767.0f);
+    out[1] = (int16_t) lrintf(vertex_clamp(y, -1.0f, 1.0f) * 32767.0f);
+}
+#pragma endregion
+
+void vertex_format_pack(vertex_format format, const vertex_source* source, size_t count, void* out, vertex_position_decode* decode)
+{
+    vertex_layout layout = vertex_format_layout(format);
+
+    float min[3] = { 0.0f, 0.0f, 0.0f };
+    float max[3] = { 0.0f, 0.0f, 0.0f };
+    for (size_t i = 0; i < count; i++)
+    {
+        const float* position = source->positions + i * source->stride;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (i == 0 || position[axis] < min[axis])
+                min[axis] = position[axis];
+            if (i == 0 || position[axis] > max[axis])
+                max[axis] = position[axis];
+        }
+    }
+
+    *decode = VERTEX_POSITION_DECODE_IDENTITY;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if (format.position == VERTEX_POSITION_UNORM16)
+        {
+            decode->scale[axis] = max[axis] - min[axis];
+            decode->offset[axis] = min[axis];
+        }
+        else if (format.position == VERTEX_POSITION_HALF)
+            decode->offset[axis] = (min[axis] + max[axis]) * 0.5f;
+    }
+
+    static const float white[3] = { 1.0f, 1.0f, 1.0f };
+    static const float zero[2] = { 0.0f, 0.0f };
+    static const float up[3] = { 0.0f, 0.0f, 1.0f };
+
+    unsigned char* vertex = out;
+    for (size_t i = 0; i < count; i++, vertex += layout.stride)
+    {
+        const float* position = source->positions + i * source->stride;
+        const float* color = source->colors ? source->colors + i * source->stride : white;
+        const float* texcoord = source->texcoords ? source->texcoords + i * source->stride : zero;
+        const float* normal = source->normals ? source->normals + i * source->stride : up;
+
+        switch (format.position)
+        {
+            case VERTEX_POSITION_FLOAT:
+                memcpy(vertex + layout.position, position, sizeof(float) * 3);
+                break;
+            case VERTEX_POSITION_HALF:
+            case VERTEX_POSITION_UNORM16:
+            {
+                // 4th component pads the attribute to 8 bytes
+                uint16_t packed[4] = { 0 };
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    if (format.position == VERTEX_POSITION_HALF)
+                        packed[axis] = vertex_half_from_float(position[axis] - decode->offset[axis]);
+                    else if (decode->scale[axis] > 0.0f)
+                        packed[axis] = vertex_unorm16((position[axis] - decode->offset[axis]) / decode->scale[axis]);
+                }
+                memcpy(vertex + layout.position, packed, sizeof(packed));
+                break;
+            }
+        }
+
+        if (format.normal == VERTEX_NORMAL_FLOAT)
+            memcpy(vertex + layout.normal, normal, sizeof(float) * 3);
+        else if (format.normal == VERTEX_NORMAL_OCTAHEDRAL)
+        {
+            int16_t packed[2];
+            vertex_octahedral_encode(normal, packed);
+            memcpy(vertex + layout.normal, packed, sizeof(packed));
+        }
+
+        if (format.color == VERTEX_COLOR_FLOAT)
+            memcpy(vertex + layout.color, color, sizeof(float) * 3);
+        else if (format.color == VERTEX_COLOR_UNORM8)
+        {
+            uint8_t packed[4] = { vertex_unorm8(color[0]), vertex_unorm8(color[1]), vertex_unorm8(color[2]), 255 };
+            memcpy(vertex + layout.color, packed, sizeof(packed));
+        }
+
+        if (format.texcoord == VERTEX_TEXCOORD_FLOAT)
+            memcpy(vertex + layout.texcoord, texcoord, sizeof(float) * 2);
+        else if (format.texcoord == VERTEX_TEXCOORD_HALF || format.texcoord == VERTEX_TEXCOORD_UNORM16)
+        {
+            uint16_t packed[2];
+            for (int k = 0; k < 2; k++)
+                packed[k] = format.texcoord == VERTEX_TEXCOORD_HALF ? vertex_half_from_float(texcoord[k]) : vertex_unorm16(texcoord[k]);
+            memcpy(vertex + layout.texcoord, packed, sizeof(packed));
+        }
+    }
+}
+
+void vertex_format_setup(vertex_format format, size_t offset)
+{
+    vertex_layout layout = vertex_format_layout(format);
+
+    static const GLenum position_types[] = { [VERTEX_POSITION_FLOAT] = GL_FLOAT, [VERTEX_POSITION_HALF] = GL_HALF_FLOAT, [VERTEX_POSITION_UNORM16] = GL_UNSIGNED_SHORT };
+    glVertexAttribPointer(VERTEX_LOCATION_POSITION, 3, position_types[format.position], format.position == VERTEX_POSITION_UNORM16,
+                          layout.stride, (void*) (offset + layout.position));
+    glEnableVertexAttribArray(VERTEX_LOCATION_POSITION);
+
+    if (format.normal == VERTEX_NORMAL_NONE)
+        glDisableVertexAttribArray(VERTEX_LOCATION_NORMAL);
+    else
+    {
+        if (format.normal == VERTEX_NORMAL_FLOAT)
+            glVertexAttribPointer(VERTEX_LOCATION_NORMAL, 3, GL_FLOAT, GL_FALSE, layout.stride, (void*) (offset + layout.normal));
+        else
+            glVertexAttribPointer(VERTEX_LOCATION_NORMAL, 2, GL_SHORT, GL_TRUE, layout.stride, (void*) (offset + layout.normal));
+        glEnableVertexAttribArray(VERTEX_LOCATION_NORMAL);
+    }
+
+    if (format.color == VERTEX_COLOR_NONE)
+    {
+        // current value is context state, not part of the VAO
+        glDisableVertexAttribArray(VERTEX_LOCATION_COLOR);
+        glVertexAttrib4f(VERTEX_LOCATION_COLOR, 1.0f, 1.0f, 1.0f, 1.0f);
+    }
+    else
+    {
+        if (format.color == VERTEX_COLOR_FLOAT)
+            glVertexAttribPointer(VERTEX_LOCATION_COLOR, 3, GL_FLOAT, GL_FALSE, layout.stride, (void*) (offset + layout.color));
+        else
+            glVertexAttribPointer(VERTEX_LOCATION_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, layout.stride, (void*) (offset + layout.color));
+        glEnableVertexAttribArray(VERTEX_LOCATION_COLOR);
+    }
+
+    if (format.texcoord == VERTEX_TEXCOORD_NONE)
+        glDisableVertexAttribArray(VERTEX_LOCATION_TEXCOORD);
+    else
+    {
+        static const GLenum texcoord_types[] = { [VERTEX_TEXCOORD_FLOAT] = GL_FLOAT, [VERTEX_TEXCOORD_HALF] = GL_HALF_FLOAT, [VERTEX_TEXCOORD_UNORM16] = GL_UNSIGNED_SHORT };
+        glVertexAttribPointer(VERTEX_LOCATION_TEXCOORD, 2, texcoord_types[format.texcoord], format.texcoord == VERTEX_TEXCOORD_UNORM16,
+                              layout.stride, (void*) (offset + layout.texcoord));
+        glEnableVertexAttribArray(VERTEX_LOCATION_TEXCOORD);
+    }
+}
+
+const char* vertex_format_defines(vertex_format format)
+{
+    return format.position == VERTEX_POSITION_FLOAT ? "" : "#define QUANTIZED_POSITION 1\n";
+}
+
+void vertex_format_upload_decode(GLuint program, const vertex_position_decode* decode)
+{
+    GLint location = shader_uniform_location(program, SHADER_UNIFORM_POSITION_SCALE);
+    if (location >= 0)
+        glUniform3fv(location, 1, decode->scale);
+
+    location = shader_uniform_location(program, SHADER_UNIFORM_POSITION_OFFSET);
+    if (location >= 0)
+        glUniform3fv(location, 1, decode->offset);
+}
@@ -0,0 +1,114 @@
+#ifndef __VERTEX_FORMAT_H__
+#define __VERTEX_FORMAT_H__
+
+#include <glad/glad.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// attribute locations of shaders/vertex.vert
+#define VERTEX_LOCATION_POSITION 0
+#define VERTEX_LOCATION_COLOR    1
+#define VERTEX_LOCATION_TEXCOORD 2
+#define VERTEX_LOCATION_NORMAL   3
+
+typedef enum vertex_position_format
+{
+    VERTEX_POSITION_FLOAT,    // 12 bytes
+    VERTEX_POSITION_HALF,     // 8 bytes, relative to the center of the bounding box
+    VERTEX_POSITION_UNORM16   // 8 bytes, 0..1 across the bounding box
+} vertex_position_format;
+
+typedef enum vertex_color_format
+{
+    VERTEX_COLOR_NONE,        // white
+    VERTEX_COLOR_FLOAT,       // 12 bytes, rgb
+    VERTEX_COLOR_UNORM8       // 4 bytes, rgba
+} vertex_color_format;
+
+typedef enum vertex_texcoord_format
+{
+    VERTEX_TEXCOORD_NONE,
+    VERTEX_TEXCOORD_FLOAT,    // 8 bytes
+    VERTEX_TEXCOORD_HALF,     // 4 bytes
+    VERTEX_TEXCOORD_UNORM16   // 4 bytes, texcoords are clamped to 0..1, see vertex_format_fit()
+} vertex_texcoord_format;
+
+typedef enum vertex_normal_format
+{
+    VERTEX_NORMAL_NONE,
+    VERTEX_NORMAL_FLOAT,      // 12 bytes
+    VERTEX_NORMAL_OCTAHEDRAL  // 4 bytes, unit sphere folded onto a square, snorm16 x 2
+} vertex_normal_format;
+
+/**
+ * interleaved vertex layout, every attribute starts 4-byte aligned
+ * unorm16 position + unorm8 color + unorm16 texcoords take 16 bytes instead of the 32 of floats
+ */
+typedef struct vertex_format
+{
+    vertex_position_format position;
+    vertex_color_format color;
+    vertex_texcoord_format texcoord;
+    vertex_normal_format normal;
+} vertex_format;
+
+// largest |texcoord| stored as half, its step there is 1/1024
+#define VERTEX_HALF_TEXCOORD_LIMIT 2.0f
+
+#define VERTEX_FORMAT_FLOAT   ((vertex_format) { VERTEX_POSITION_FLOAT, VERTEX_COLOR_FLOAT, VERTEX_TEXCOORD_FLOAT, VERTEX_NORMAL_NONE })
+#define VERTEX_FORMAT_COMPACT ((vertex_format) { VERTEX_POSITION_UNORM16, VERTEX_COLOR_UNORM8, VERTEX_TEXCOORD_UNORM16, VERTEX_NORMAL_NONE })
+
+/**
+ * float attributes to pack, stride in floats, attributes left NULL are written as white / 0 / +z
+ */
+typedef struct vertex_source
+{
+    const float* positions;
+    const float* colors;
+    const float* texcoords;
+    const float* normals;
+    size_t stride;
+} vertex_source;
+
+/**
+ * stored position * scale + offset is the mesh space position, set per mesh in the shader
+ * identity for float positions
+ */
+typedef struct vertex_position_decode
+{
+    float scale[3];
+    float offset[3];
+} vertex_position_decode;
+
+#define VERTEX_POSITION_DECODE_IDENTITY ((vertex_position_decode) { { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 0.0f } })
+
+GLsizei vertex_format_stride(vertex_format format);
+
+/**
+ * format with the attributes widened that would not survive its encoding,
+ * texcoords outside 0..1 (tiled, mirrored) fall back from unorm16 to half, beyond VERTEX_HALF_TEXCOORD_LIMIT to float
+ */
+vertex_format vertex_format_fit(vertex_format format, const vertex_source* source, size_t count);
+
+/**
+ * packs count vertices into out (count * stride bytes) and fills decode from their bounding box
+ */
+void vertex_format_pack(vertex_format format, const vertex_source* source, size_t count, void* out, vertex_position_decode* decode);
+
+/**
+ * points the attributes of the bound VAO at the bound GL_ARRAY_BUFFER, vertices start at offset
+ * without colors the color attribute is disabled and its current value set to white
+ */
+void vertex_format_setup(vertex_format format, size_t offset);
+
+/**
+ * defines of the vertex shader variant decoding format (see shaders/vertex_format.glsl), may be ""
+ */
+const char* vertex_format_defines(vertex_format format);
+
+/**
+ * sets position_scale and position_offset of the program in use, skipped when it does not decode positions
+ */
+void vertex_format_upload_decode(GLuint program, const vertex_position_decode* decode);
+
+#endif // __VERTEX_FORMAT_H__
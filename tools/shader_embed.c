@@ -0,0 +1,102 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/utils.h"
+
+#define ENABLE_LOGS
+#include "../src/debug.h"
+
+/**
+ * build step: compiles shader sources into the executable
+ * usage: shader_embed output.c shader...
+ * writes one NUL terminated byte array per file and the shader_embedded_table (see src/shader_embedded.h)
+ */
+
+// leading "./" is dropped so "./shaders/a.vert" and "shaders/a.vert" name the same entry
+static const char* shader_embed_key(const char* path)
+{
+    while (strncmp(path, "./", 2) == 0)
+        path += 2;
+    return path;
+}
+
+static unsigned char* shader_embed_read(const char* path, size_t* size)
+{
+    FILE* f = fopen(path, "rb");
+    if (f == NULL)
+        return NULL;
+
+    fseek(f, 0, SEEK_END);
+    long length = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    unsigned char* data = malloc(length > 0 ? length : 1);
+    my_assert(data, "failed to allocate shader source");
+    *size = fread(data, 1, length, f);
+    fclose(f);
+    return data;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s output.c shader...\n", argv[0]);
+        return 1;
+    }
+
+    FILE* out = fopen(argv[1], "w");
+    if (out == NULL)
+    {
+        my_log(ERRMSG("failed to open output: ") PATHMSG("%s\n"), argv[1]);
+        return 1;
+    }
+
+    fprintf(out, "// generated by tools/shader_embed.c, do not edit\n");
+    fprintf(out, "#include \"shader_embedded.h\"\n");
+
+    int count = argc - 2;
+    uint64_t* hashes = calloc(count ? count : 1, sizeof(uint64_t));
+    size_t* sizes = calloc(count ? count : 1, sizeof(size_t));
+    my_assert(hashes && sizes, "failed to allocate shader table");
+
+    bool ok = true;
+    for (int i = 0; i < count; i++)
+    {
+        const char* path = argv[i + 2];
+        unsigned char* data = shader_embed_read(path, &sizes[i]);
+        if (data == NULL)
+        {
+            my_log(ERRMSG("failed to open shader: ") PATHMSG("%s\n"), path);
+            ok = false;
+            break;
+        }
+        hashes[i] = hash_fnv1a(data, sizes[i], HASH_FNV1A_SEED);
+
+        fprintf(out, "\n// %s\nstatic const char shader_embedded_%d[] = {", path, i);
+        for (size_t b = 0; b < sizes[i]; b++)
+            fprintf(out, "%s0x%02x,", b % 16 ? " " : "\n    ", data[b]);
+        fprintf(out, "\n    0x00\n};\n");
+        free(data);
+    }
+
+    if (ok)
+    {
+        fprintf(out, "\nconst shader_embedded shader_embedded_table[] = {\n");
+        for (int i = 0; i < count; i++)
+            fprintf(out, "    { \"%s\", shader_embedded_%d, %zu, 0x%016llxull },\n",
+                    shader_embed_key(argv[i + 2]), i, sizes[i], (unsigned long long) hashes[i]);
+        // keeps the array non-empty without shaders
+        fprintf(out, "    { 0 }\n};\n\nconst int shader_embedded_count = %d;\n", count);
+    }
+
+    free(hashes);
+    free(sizes);
+    ok = fclose(out) == 0 && ok;
+    if (!ok)
+        remove(argv[1]);
+
+    return ok ? 0 : 1;
+}
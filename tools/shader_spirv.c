@@ -0,0 +1,116 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "../src/shader_preprocessor.h"
+#include "../src/shader_spirv.h"
+
+#define ENABLE_LOGS
+#include "../src/debug.h"
+
+/**
+ * offline step: GLSL -> SPIR-V modules for ARB_gl_spirv
+ * usage: shader_spirv [-c glslangValidator] [-D feature]... shader.vert|shader.frag...
+ *   -c  glslang front-end to run, default glslangValidator from PATH
+ *   -D  feature of a variant, given in the order of the shader_variants feature list
+ * sources are preprocessed exactly like at runtime and the module is named by the hash of the result
+ * (see shader_spirv_path()), so the runtime finds it only for the very same text
+ */
+
+#define SHADER_SPIRV_MAX_FEATURES 8
+
+static const char* shader_spirv_stage(const char* path)
+{
+    const char* extension = strrchr(path, '.');
+    if (extension && strcmp(extension, ".vert") == 0)
+        return "vert";
+    if (extension && strcmp(extension, ".frag") == 0)
+        return "frag";
+    return NULL;
+}
+
+static bool shader_spirv_compile(const char* compiler, const char* path, const char* defines)
+{
+    const char* stage = shader_spirv_stage(path);
+    if (stage == NULL)
+    {
+        my_log(ERRMSG("unknown shader stage: ") PATHMSG("%s\n"), path);
+        return false;
+    }
+
+    char* source = shader_preprocess(path, defines, NULL);
+    if (source == NULL)
+        return false;
+
+    char module[256];
+    char glsl[272];
+    shader_spirv_path(source, module, sizeof(module));
+    snprintf(glsl, sizeof(glsl), "%s.glsl", module);
+
+    FILE* f = fopen(glsl, "w");
+    bool ok = f != NULL && fputs(source, f) >= 0;
+    ok = (f == NULL || fclose(f) == 0) && ok;
+    free(source);
+    if (!ok)
+    {
+        my_log(ERRMSG("failed to write: ") PATHMSG("%s\n"), glsl);
+        return false;
+    }
+
+    // varyings get locations in declaration order, both stages declare them in the same order
+    char command[1024];
+    snprintf(command, sizeof(command), "%s -G --auto-map-locations -S %s -o %s %s", compiler, stage, module, glsl);
+    ok = system(command) == 0;
+    remove(glsl);
+
+    my_log_if(ok, SCCSMSG("compiled: ") PATHMSG("%s") " -> " PATHMSG("%s\n"), path, module);
+    my_log_if(!ok, ERRMSG("failed to compile to SPIR-V: ") PATHMSG("%s\n"), path);
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    const char* compiler = "glslangValidator";
+    char defines[SHADER_SPIRV_MAX_FEATURES * 64 + 1] = "";
+    int features = 0;
+
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; i++)
+    {
+        if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+            compiler = argv[++i];
+        else if (strcmp(argv[i], "-D") == 0 && i + 1 < argc && features < SHADER_SPIRV_MAX_FEATURES)
+        {
+            // same text shader_variants injects
+            size_t length = strlen(defines);
+            snprintf(defines + length, sizeof(defines) - length, "#define %.48s 1\n", argv[++i]);
+            features++;
+        }
+        else
+            break;
+    }
+
+    if (i >= argc)
+    {
+        fprintf(stderr, "usage: %s [-c glslangValidator] [-D feature]... shader.vert|shader.frag...\n", argv[0]);
+        return 1;
+    }
+
+    if (mkdir(SHADER_SPIRV_DIR, 0755) != 0 && errno != EEXIST)
+    {
+        my_log(ERRMSG("failed to create: ") PATHMSG("%s\n"), SHADER_SPIRV_DIR);
+        return 1;
+    }
+
+    // the files on disk are what make embeds too
+    shader_preprocess_set_mode(SHADER_SOURCE_DISK);
+
+    int failed = 0;
+    for (; i < argc; i++)
+        failed += !shader_spirv_compile(compiler, argv[i], features ? defines : NULL);
+
+    return failed ? 1 : 0;
+}
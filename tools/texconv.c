@@ -0,0 +1,179 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "../src/vendor/stb_image.h"
+
+#include "../src/bc.h"
+#include "../src/ktx2.h"
+#include "../src/mipmap.h"
+#include "../src/pixel.h"
+#include "../src/utils.h"
+
+#define ENABLE_LOGS
+#include "../src/debug.h"
+
+/**
+ * offline converter: PNG/JPEG -> block compressed KTX2 with a full mip chain
+ * usage: texconv [-f bc1|bc3|bc7] [-s] [-n] image...
+ *   -f  block format, default bc3 for images with alpha and bc1 otherwise
+ *   -s  tag the data as sRGB, mips are filtered in linear light
+ *   -n  keep top-down rows, by default rows are flipped like the runtime loader does
+ */
+
+typedef struct texconv_options
+{
+    int format; // bc_format or -1 for automatic
+    bool srgb;
+    bool flip;
+} texconv_options;
+
+static uint32_t texconv_vk_format(bc_format format, bool srgb)
+{
+    switch (format)
+    {
+        case BC_FORMAT_BC1: return srgb ? KTX2_VK_FORMAT_BC1_RGB_SRGB : KTX2_VK_FORMAT_BC1_RGB_UNORM;
+        case BC_FORMAT_BC3: return srgb ? KTX2_VK_FORMAT_BC3_SRGB : KTX2_VK_FORMAT_BC3_UNORM;
+        default:            return srgb ? KTX2_VK_FORMAT_BC7_SRGB : KTX2_VK_FORMAT_BC7_UNORM;
+    }
+}
+
+/**
+ * whole file, NULL when it can't be read
+ */
+static unsigned char* texconv_read_file(const char* path, size_t* size)
+{
+    FILE* f = fopen(path, "rb");
+    if (f == NULL)
+        return NULL;
+
+    fseek(f, 0, SEEK_END);
+    long length = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    unsigned char* bytes = length > 0 ? malloc(length) : NULL;
+    if (bytes && fread(bytes, 1, length, f) != (size_t) length)
+    {
+        free(bytes);
+        bytes = NULL;
+    }
+    fclose(f);
+    *size = length > 0 ? (size_t) length : 0;
+    return bytes;
+}
+
+static bool texconv_convert(const char* path, const texconv_options* options)
+{
+    // the runtime compares this against the source it would otherwise decode
+    size_t source_size;
+    unsigned char* file = texconv_read_file(path, &source_size);
+    uint64_t source_hash = file ? hash_fnv1a(file, source_size, HASH_FNV1A_SEED) : 0;
+
+    int width, height, channels;
+    const char* failure_reason = "can't read file";
+    unsigned char* rgba = NULL;
+    if (file)
+    {
+        rgba = stbi_load_from_memory(file, (int) source_size, &width, &height, &channels, 4);
+        failure_reason = stbi_failure_reason();
+        free(file);
+    }
+    if (rgba == NULL)
+    {
+        my_log(ERRMSG("failed to load image: ") PATHMSG("%s") " (%s)\n", path, failure_reason);
+        return false;
+    }
+
+    if (options->flip)
+        pixel_flip_vertical(rgba, width, height, 4);
+
+    bool has_alpha = channels == 2 || channels == 4;
+    bc_format format = options->format >= 0 ? (bc_format) options->format : (has_alpha ? BC_FORMAT_BC3 : BC_FORMAT_BC1);
+
+    mip_chain source;
+    bool ok = mip_chain_generate(&source, rgba, width, height, 4, options->srgb);
+    stbi_image_free(rgba);
+    if (!ok)
+        return false;
+
+    // same level layout, sizes in compressed bytes
+    mip_chain compressed = { .channels = 0, .level_count = source.level_count };
+    for (int i = 0; i < source.level_count; i++)
+    {
+        compressed.levels[i] = source.levels[i];
+        compressed.levels[i].offset = compressed.size;
+        compressed.levels[i].size = bc_image_size(format, source.levels[i].width, source.levels[i].height);
+        compressed.size += compressed.levels[i].size;
+    }
+
+    compressed.data = malloc(compressed.size);
+    my_assert(compressed.data, "failed to allocate compressed levels");
+
+    for (int i = 0; i < source.level_count; i++)
+    {
+        const mip_level* level = &source.levels[i];
+        bc_encode_image(format, source.data + level->offset, level->width, level->height,
+                        compressed.data + compressed.levels[i].offset);
+    }
+
+    char out_path[4096];
+    ktx2_path(path, out_path, sizeof(out_path));
+    ok = ktx2_write(out_path, texconv_vk_format(format, options->srgb), options->flip, source_hash, &compressed);
+
+    if (ok)
+    {
+        static const char* names[] = { "BC1", "BC3", "BC7" };
+        my_log(SCCSMSG("%s") " -> " PATHMSG("%s") " %dx%d %s, %d levels, %zu bytes\n",
+               path, out_path, width, height, names[format], compressed.level_count, compressed.size);
+    }
+
+    free(compressed.data);
+    mip_chain_free(&source);
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    texconv_options options = { .format = -1, .srgb = false, .flip = true };
+    int failures = 0;
+    int converted = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+        {
+            const char* name = argv[++i];
+            if (strcmp(name, "bc1") == 0)       options.format = BC_FORMAT_BC1;
+            else if (strcmp(name, "bc3") == 0)  options.format = BC_FORMAT_BC3;
+            else if (strcmp(name, "bc7") == 0)  options.format = BC_FORMAT_BC7;
+            else
+            {
+                my_log(ERRMSG("unknown format: %s\n"), name);
+                return EXIT_FAILURE;
+            }
+        }
+        else if (strcmp(argv[i], "-s") == 0)
+        {
+            options.srgb = true;
+        }
+        else if (strcmp(argv[i], "-n") == 0)
+        {
+            options.flip = false;
+        }
+        else
+        {
+            failures += !texconv_convert(argv[i], &options);
+            converted++;
+        }
+    }
+
+    if (converted == 0)
+    {
+        fprintf(stderr, "usage: %s [-f bc1|bc3|bc7] [-s] [-n] image...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}